@@ -10,8 +10,34 @@
 #include <string.h>
 #include <stdio.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <errno.h>
+#include <limits.h>
 #include <assert.h>
 
+#define TRACE_BUFFER_RECORDS 4096   // The default number of records buffered before the binary trace is flushed to its file
+#define TRACE_MAGIC "MEMTRC1"       // The magic string identifying a Memory Management binary trace file
+#define CHECKPOINT_MAGIC "MEMCKP1"  // The magic string identifying a Memory Management checkpoint file
+
+// Defines the states a PCB can be in
+typedef enum {
+    STATE_NEW,
+    STATE_READY,
+    STATE_RUNNING,
+    STATE_WAITING,
+    STATE_TERMINATED
+} state_t;
+
+// The names of the states as they appear in the text output
+const char *state_names[] = {"New", "Ready", "Running", "Waiting", "Terminated"};
+
+// Defines the ways the state transitions can be logged
+typedef enum {
+    LOG_TEXT,     // Every transition is formatted and appended to the output file as it happens
+    LOG_BINARY,   // Every transition is stored as a fixed-size record and rendered to text later
+    LOG_NONE      // The transitions are not logged
+} log_mode_t;
+
 // Defines a structure for the PCB with the necessary information
 typedef struct pcb {	
     int pid;                    
@@ -47,6 +73,91 @@ typedef struct {
     bool used;
 } memory_t;
 
+// Defines a structure holding the complete state of a simulation, which is everything a checkpoint has to save
+typedef struct {
+    queue_t *new_queue;
+    queue_t *ready_queue;
+    queue_t *running_queue;
+    queue_t *waiting_queue;
+    queue_t *terminated_queue;
+    memory_t** memory_management;   // The main memory table
+    int running_time;               // The running time of the PCB in the running state
+    int pcb_num;                    // The number of PCBs in the simulation
+    int clock;                      // The timer
+} simulation_t;
+
+// Defines when the state of a simulation is saved to a checkpoint file and when the simulation is paused
+typedef struct {
+    const char *filename;   // The name of the checkpoint file, or NULL if no checkpoints are saved
+    int interval;           // A checkpoint is saved every interval ticks (0 to disable)
+    int stop_time;          // The simulation is paused at this time after saving a checkpoint (-1 to run to the end)
+} checkpoint_t;
+
+// Defines the settings of a run, read from the command line and the optional config file
+typedef struct {
+    const char *input;          // The name of the input CSV file
+    const char *output;         // The name of the output file for the state transitions
+    int partitions[4];          // The sizes of the memory partitions
+    bool partitions_set;        // true if the partition sizes were given
+    log_mode_t log_mode;        // How the state transitions are logged
+    int trace_buffer;           // The number of records buffered by the binary trace
+    int file_buffer;            // The size in bytes of the buffer of the telemetry file (0 for the default)
+    checkpoint_t checkpoint;    // When checkpoints are saved and the simulation is paused
+    const char *resume;         // The name of the checkpoint file to resume from, or NULL
+    const char *telemetry;      // The name of the telemetry file, or NULL
+    int telemetry_interval;     // A telemetry sample is recorded every telemetry_interval ticks, or on change if 0
+    bool telemetry_interval_set;// true if the telemetry interval was given
+} config_t;
+
+// Defines the header written at the start of a checkpoint file, it is followed by the memory table and the PCBs
+typedef struct {
+    char magic[8];          // CHECKPOINT_MAGIC
+    int32_t pcb_size;       // sizeof(pcb_t), used to reject checkpoints from an incompatible build
+    int32_t clock;          // The timer
+    int32_t running_time;   // The running time of the PCB in the running state
+    int32_t queue_sizes[5]; // The sizes of the new, ready, running, waiting and terminated queues
+} checkpoint_header_t;
+
+// Defines a structure for sampling the queue depths, the memory usage and the CPU utilisation over simulated time
+typedef struct {
+    FILE *file;          // The open telemetry file, or NULL if no telemetry is recorded
+    int interval;        // A sample is recorded every interval ticks, or whenever a gauge changes if 0
+    int busy_ticks;      // The number of ticks the CPU was busy since the last sample
+    int ticks;           // The number of ticks since the last sample
+    int last_ready;      // The size of the ready queue in the last sample
+    int last_waiting;    // The size of the waiting queue in the last sample
+    int last_running;    // The size of the running queue in the last sample
+    int last_memory;     // The used memory in the last sample
+} telemetry_t;
+
+// Defines a fixed-size record for one state transition in the binary trace
+typedef struct {
+    int32_t time;         // The time at which the PCB switches states
+    int32_t pid;          // The process ID
+    uint8_t old_state;    // The old state of the PCB (a state_t value)
+    uint8_t new_state;    // The new state of the PCB (a state_t value)
+    int16_t partition;    // The partition the PCB enters or is removed from
+    int32_t memory;       // The memory needed by the PCB
+} trace_record_t;
+
+// Defines the header written at the start of a binary trace file
+typedef struct {
+    char magic[8];                  // TRACE_MAGIC
+    int32_t record_size;            // sizeof(trace_record_t), used to reject traces from an incompatible build
+    int32_t partition_sizes[4];     // The sizes of the memory partitions, needed to rebuild the memory columns
+    int32_t partition_used[4];      // The memory used in every partition when the trace starts, not 0 for a resumed simulation
+} trace_header_t;
+
+// Defines a structure for the transition log of a simulation
+typedef struct {
+    log_mode_t mode;          // How the transitions are logged
+    const char *filename;     // The name of the output file
+    FILE *file;               // The open output file (binary mode only)
+    trace_record_t *buffer;   // The records not yet written to the file (binary mode only)
+    int count;                // The number of records in the buffer
+    int capacity;             // The number of records the buffer can hold
+} trace_t;
+
 /**
  * Allocates and initializes an array of memory_t structures to manage memory partitions (main memory table).
  *
@@ -252,25 +363,30 @@ queue_t *read_CSV_file(const char filename[]){
 }
 
 /**
- * Writes information about the main memory and PCB states to the specified output file at specific times.
+ * Prints the column titles of the output file.
  *
- * @param filename           The name of the output file.
+ * @param file   The open output file.
+ */
+void print_header(FILE *file) {
+    fprintf(file, "%-8s %-8s %-25s %-25s %-20s %-20s %-23s %-18s %-18s %-15s %-15s\n", "Time", "PID", "Partition # of Entry", "Partition # of Removal", "Total Used Memory", "Total Free Memory", "Total Usable Memory", "Used Partitions", "Free Partitions", "Old State", "New State");
+}
+
+/**
+ * Prints one state transition together with the state of the main memory as a line of the output file.
+ *
+ * @param file               The open output file.
  * @param time               The time at which the PCB switches states.
- * @param pcb                Pointer to the PCB.
+ * @param pid                The process ID.
+ * @param position           The partition the PCB enters or is removed from.
+ * @param entry              true if the PCB enters the partition, false if it is removed from it.
  * @param MemoryManagement   A pointer to the memory management array.
  * @param oldState           The old state of the PCB.
  * @param newState           The new state of the PCB.
  */
-void write_text_file(const char *filename, int time, pcb_t* pcb, memory_t** MemoryManagement, const char *oldState, const char *newState) {
-    FILE *file = fopen(filename, "a");
+void print_transition(FILE *file, int time, int pid, int position, bool entry, memory_t** MemoryManagement, const char *oldState, const char *newState) {
     int usedMemory = 0, freeMemory = 0, usableMemory = 0;
     char usedPartitionStr[50] = "";
     char freePartitionStr[50] = "";
-    
-    if (file == NULL) {
-        printf("Error opening file %s\n", filename);
-        return;
-    }
 
     for (int i = 0; i < 4; i++) {
         freeMemory += MemoryManagement[i]->partition_free;
@@ -283,41 +399,506 @@ void write_text_file(const char *filename, int time, pcb_t* pcb, memory_t** Memo
         }
     }
 
-    if(pcb->remaining_CPU_time){
-        fprintf(file, "%-8d %-8d %-25d %-25s %-20d %-20d %-23d %-18s %-18s %-15s %-15s\n", time, pcb->pid, pcb->memory_position, "", usedMemory, freeMemory, usableMemory, usedPartitionStr, freePartitionStr, oldState, newState);
+    if(entry){
+        fprintf(file, "%-8d %-8d %-25d %-25s %-20d %-20d %-23d %-18s %-18s %-15s %-15s\n", time, pid, position, "", usedMemory, freeMemory, usableMemory, usedPartitionStr, freePartitionStr, oldState, newState);
     }
     else{
-        fprintf(file, "%-8d %-8d %-25s %-25d %-20d %-20d %-23d %-18s %-18s %-15s %-15s\n", time, pcb->pid, "", pcb->memory_position, usedMemory, freeMemory, usableMemory, usedPartitionStr, freePartitionStr, oldState, newState); 
+        fprintf(file, "%-8d %-8d %-25s %-25d %-20d %-20d %-23d %-18s %-18s %-15s %-15s\n", time, pid, "", position, usedMemory, freeMemory, usableMemory, usedPartitionStr, freePartitionStr, oldState, newState); 
+    }
+}
+
+/**
+ * Writes information about the main memory and PCB states to the specified output file at specific times.
+ *
+ * @param filename           The name of the output file.
+ * @param time               The time at which the PCB switches states.
+ * @param pcb                Pointer to the PCB.
+ * @param MemoryManagement   A pointer to the memory management array.
+ * @param oldState           The old state of the PCB.
+ * @param newState           The new state of the PCB.
+ */
+void write_text_file(const char *filename, int time, pcb_t* pcb, memory_t** MemoryManagement, const char *oldState, const char *newState) {
+    FILE *file = fopen(filename, "a");
+    
+    if (file == NULL) {
+        printf("Error opening file %s\n", filename);
+        return;
     }
 
+    print_transition(file, time, pcb->pid, pcb->memory_position, pcb->remaining_CPU_time != 0, MemoryManagement, oldState, newState);
+
     fclose(file);
 }
 
+/**
+ * Writes the buffered trace records to the binary trace file and empties the buffer.
+ *
+ * @param trace   A pointer to the transition log.
+ */
+void flush_trace(trace_t *trace) {
+    if (trace->count != 0) {
+        fwrite(trace->buffer, sizeof(trace_record_t), trace->count, trace->file);
+        trace->count = 0;
+    }
+}
+
+/**
+ * Opens the transition log and writes the header of the output file.
+ *
+ * @param trace      A pointer to the transition log to initialize.
+ * @param filename   The name of the output file.
+ * @param mode       How the transitions are logged.
+ * @param MemoryManagement   A pointer to the memory management array, whose partition sizes and use are stored in the header.
+ * @param capacity           The number of records buffered before the binary trace is flushed to its file.
+ * @return                   true if the output file could be created, false otherwise.
+ */
+bool open_trace(trace_t *trace, const char *filename, log_mode_t mode, memory_t** MemoryManagement, int capacity) {
+    trace->mode = mode;
+    trace->filename = filename;
+    trace->file = NULL;
+    trace->buffer = NULL;
+    trace->count = 0;
+    trace->capacity = capacity;
+
+    if (mode == LOG_NONE) {
+        return true;
+    }
+
+    if (mode == LOG_TEXT) {
+        FILE *file = fopen(filename, "w");
+        if (file == NULL) {
+            printf("Error opening file %s\n", filename);
+            return false;
+        }
+        print_header(file);
+        fclose(file);
+        return true;
+    }
+
+    trace->file = fopen(filename, "wb");
+    if (trace->file == NULL) {
+        printf("Error opening file %s\n", filename);
+        return false;
+    }
+
+    trace_header_t header = {TRACE_MAGIC, sizeof(trace_record_t), {0}, {0}};
+    for (int i = 0; i < 4; i++) {
+        header.partition_sizes[i] = MemoryManagement[i]->memory_size;
+        header.partition_used[i] = MemoryManagement[i]->partition_used;
+    }
+    fwrite(&header, sizeof(header), 1, trace->file);
+
+    trace->buffer = malloc((size_t)capacity * sizeof(trace_record_t));
+    assert(trace->buffer != NULL);
+    return true;
+}
+
+/**
+ * Flushes any buffered records and closes the transition log.
+ *
+ * @param trace   A pointer to the transition log.
+ */
+void close_trace(trace_t *trace) {
+    if (trace->mode == LOG_BINARY) {
+        flush_trace(trace);
+        fclose(trace->file);
+        free(trace->buffer);
+        trace->file = NULL;
+        trace->buffer = NULL;
+    }
+}
+
+/**
+ * Logs a state transition of a PCB, either as a line of text or as a binary trace record.
+ * Only the partition and the memory needed are recorded in binary mode, the memory columns are rebuilt when the trace is rendered.
+ *
+ * @param trace              A pointer to the transition log.
+ * @param time               The time at which the PCB switches states.
+ * @param pcb                Pointer to the PCB.
+ * @param MemoryManagement   A pointer to the memory management array.
+ * @param oldState           The old state of the PCB.
+ * @param newState           The new state of the PCB.
+ */
+void log_transition(trace_t *trace, int time, pcb_t* pcb, memory_t** MemoryManagement, state_t oldState, state_t newState) {
+    if (trace->mode == LOG_NONE) {
+        return;
+    }
+    if (trace->mode == LOG_TEXT) {
+        write_text_file(trace->filename, time, pcb, MemoryManagement, state_names[oldState], state_names[newState]);
+        return;
+    }
+
+    trace_record_t *record = &trace->buffer[trace->count++];
+    record->time = time;
+    record->pid = pcb->pid;
+    record->old_state = oldState;
+    record->new_state = newState;
+    record->partition = pcb->memory_position;
+    record->memory = pcb->memory_needed;
+
+    if (trace->count == trace->capacity) {
+        flush_trace(trace);
+    }
+}
+
+/**
+ * Converts a binary trace file into the text output layout.
+ * The main memory table is replayed from the partition sizes and use in the header, a PCB is allocated its partition when it
+ * enters the ready state and the partition is deallocated when it terminates, exactly as in flow_process.
+ *
+ * @param trace_filename    The name of the binary trace file.
+ * @param output_filename   The name of the text output file.
+ * @return                  true if the trace was rendered, false if it could not be read or a record is corrupted.
+ */
+bool render_trace(const char *trace_filename, const char *output_filename) {
+    FILE *input = fopen(trace_filename, "rb");
+    if (input == NULL) {
+        printf("Error opening file %s\n", trace_filename);
+        return false;
+    }
+
+    trace_header_t header;
+    if (fread(&header, sizeof(header), 1, input) != 1 ||
+        memcmp(header.magic, TRACE_MAGIC, sizeof(header.magic)) != 0 ||
+        header.record_size != sizeof(trace_record_t)) {
+        printf("%s is not a Memory Management binary trace.\n", trace_filename);
+        fclose(input);
+        return false;
+    }
+
+    // A truncated trace ends with part of a record
+    long header_end = ftell(input);
+    fseek(input, 0, SEEK_END);
+    long trace_size = ftell(input) - header_end;
+    fseek(input, header_end, SEEK_SET);
+    if (trace_size % (long)sizeof(trace_record_t) != 0) {
+        printf("%s is truncated.\n", trace_filename);
+        fclose(input);
+        return false;
+    }
+
+    FILE *output = fopen(output_filename, "w");
+    if (output == NULL) {
+        printf("Error opening file %s\n", output_filename);
+        fclose(input);
+        return false;
+    }
+
+    int size[4] = {header.partition_sizes[0], header.partition_sizes[1], header.partition_sizes[2], header.partition_sizes[3]};
+    memory_t** memory_management = MemoryManagement(size);
+    pcb_t pcb;
+
+    // A resumed simulation starts its trace with the partitions held by the PCBs that were admitted before the checkpoint
+    for (int i = 0; i < 4; i++) {
+        if (header.partition_used[i] != 0) {
+            pcb.memory_needed = header.partition_used[i];
+            allocate_memory(memory_management[i], &pcb);
+        }
+    }
+
+    print_header(output);
+
+    trace_record_t records[TRACE_BUFFER_RECORDS];
+    size_t count;
+    long record_number = 0;
+    bool valid = true;
+    while (valid && (count = fread(records, sizeof(trace_record_t), TRACE_BUFFER_RECORDS, input)) > 0) {
+        for (size_t i = 0; i < count; i++) {
+            trace_record_t *record = &records[i];
+            record_number++;
+            if (record->old_state > STATE_TERMINATED || record->new_state > STATE_TERMINATED || record->partition < 0 || record->partition >= 4) {
+                printf("Record %ld of %s is corrupted.\n", record_number, trace_filename);
+                valid = false;
+                break;
+            }
+            bool entry = record->new_state != STATE_TERMINATED;
+
+            if (record->old_state == STATE_NEW) {
+                pcb.memory_needed = record->memory;
+                allocate_memory(memory_management[record->partition], &pcb);
+            }
+            else if (!entry) {
+                deallocate_memory(memory_management[record->partition]);
+            }
+
+            print_transition(output, record->time, record->pid, record->partition, entry, memory_management, state_names[record->old_state], state_names[record->new_state]);
+        }
+    }
+
+    for (int i = 0; i < 4; i++) {
+        free(memory_management[i]);
+    }
+    free(memory_management);
+    fclose(output);
+    fclose(input);
+    return valid;
+}
+
+/**
+ * Allocates a simulation on the heap with all PCBs in the new queue, an empty memory table and the timer at 0.
+ *
+ * @param new_queue   A pointer to the queue containing PCBs to process.
+ * @param size        An array containing the sizes of the memory partitions.
+ * @return            A pointer to the simulation created.
+ */
+simulation_t *new_simulation(queue_t *new_queue, int size[]) {
+    simulation_t *sim = malloc(sizeof(simulation_t));
+    assert(sim != NULL);
+    sim->new_queue = new_queue;
+    sim->ready_queue = alloc_queue();
+    sim->running_queue = alloc_queue();
+    sim->waiting_queue = alloc_queue();
+    sim->terminated_queue = alloc_queue();
+    sim->memory_management = MemoryManagement(size);
+    sim->running_time = 0;
+    sim->pcb_num = new_queue->size;
+    sim->clock = 0;
+    return sim;
+}
+
+/**
+ * Saves the state of a simulation to a checkpoint file.
+ * The file is written under a temporary name first so a crash while saving never destroys the previous checkpoint.
+ *
+ * @param sim        A pointer to the simulation to save.
+ * @param filename   The name of the checkpoint file.
+ * @return           true if the checkpoint was saved, false otherwise.
+ */
+bool save_checkpoint(const simulation_t *sim, const char *filename) {
+    queue_t *queues[5] = {sim->new_queue, sim->ready_queue, sim->running_queue, sim->waiting_queue, sim->terminated_queue};
+    char temp_filename[1024];
+    snprintf(temp_filename, sizeof(temp_filename), "%s.tmp", filename);
+
+    FILE *file = fopen(temp_filename, "wb");
+    if (file == NULL) {
+        printf("Error opening file %s\n", temp_filename);
+        return false;
+    }
+
+    checkpoint_header_t header = {CHECKPOINT_MAGIC, sizeof(pcb_t), sim->clock, sim->running_time, {0}};
+    for (int i = 0; i < 5; i++) {
+        header.queue_sizes[i] = queues[i]->size;
+    }
+    fwrite(&header, sizeof(header), 1, file);
+
+    for (int i = 0; i < 4; i++) {
+        fwrite(sim->memory_management[i], sizeof(memory_t), 1, file);
+    }
+
+    // The PCBs of each queue are saved in queue order, counting by size since dequeued nodes keep their old next pointer
+    for (int i = 0; i < 5; i++) {
+        node_t *current = queues[i]->front;
+        for (int j = 0; j < queues[i]->size; j++) {
+            fwrite(current->pcb, sizeof(pcb_t), 1, file);
+            current = current->next;
+        }
+    }
+
+    bool saved = (fclose(file) == 0);
+    if (!saved) {
+        printf("Error writing file %s\n", temp_filename);
+        return false;
+    }
+
+    remove(filename);
+    if (rename(temp_filename, filename) != 0) {
+        printf("Error renaming %s to %s\n", temp_filename, filename);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Restores a simulation from a checkpoint file.
+ *
+ * @param filename   The name of the checkpoint file.
+ * @return           A pointer to the restored simulation, or NULL if the file could not be read.
+ */
+simulation_t *load_checkpoint(const char *filename) {
+    FILE *file = fopen(filename, "rb");
+    if (file == NULL) {
+        printf("Error opening file %s\n", filename);
+        return NULL;
+    }
+
+    checkpoint_header_t header;
+    if (fread(&header, sizeof(header), 1, file) != 1 ||
+        memcmp(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic)) != 0 ||
+        header.pcb_size != sizeof(pcb_t)) {
+        printf("%s is not a Memory Management checkpoint.\n", filename);
+        fclose(file);
+        return NULL;
+    }
+
+    int size[4] = {0, 0, 0, 0};
+    simulation_t *sim = new_simulation(alloc_queue(), size);
+    queue_t *queues[5] = {sim->new_queue, sim->ready_queue, sim->running_queue, sim->waiting_queue, sim->terminated_queue};
+    sim->clock = header.clock;
+    sim->running_time = header.running_time;
+    sim->pcb_num = 0;
+
+    for (int i = 0; i < 4; i++) {
+        if (fread(sim->memory_management[i], sizeof(memory_t), 1, file) != 1) {
+            printf("%s is truncated.\n", filename);
+            fclose(file);
+            return NULL;
+        }
+    }
+
+    for (int i = 0; i < 5; i++) {
+        for (int j = 0; j < header.queue_sizes[i]; j++) {
+            pcb_t *pcb = malloc(sizeof(pcb_t));
+            assert(pcb != NULL);
+            if (fread(pcb, sizeof(pcb_t), 1, file) != 1) {
+                printf("%s is truncated.\n", filename);
+                free(pcb);
+                fclose(file);
+                return NULL;
+            }
+            node_t *p = malloc(sizeof(node_t));
+            assert(p != NULL);
+            p->pcb = pcb;
+            p->next = NULL;
+            enqueue(queues[i], p);
+            sim->pcb_num++;
+        }
+    }
+
+    fclose(file);
+    return sim;
+}
+
+/**
+ * Opens the telemetry file and writes its column titles.
+ *
+ * @param telemetry   A pointer to the telemetry sampler to initialize.
+ * @param filename    The name of the telemetry file.
+ * @param interval    A sample is recorded every interval ticks, or whenever a gauge changes if 0.
+ * @param buffer      The size in bytes of the file buffer, or 0 for the default.
+ * @return            true if the telemetry file could be created, false otherwise.
+ */
+bool open_telemetry(telemetry_t *telemetry, const char *filename, int interval, int buffer) {
+    telemetry->interval = interval;
+    telemetry->busy_ticks = 0;
+    telemetry->ticks = 0;
+    telemetry->last_ready = -1;
+    telemetry->last_waiting = -1;
+    telemetry->last_running = -1;
+    telemetry->last_memory = -1;
+    telemetry->file = fopen(filename, "w");
+    if (telemetry->file == NULL) {
+        printf("Error opening file %s\n", filename);
+        return false;
+    }
+    if (buffer > 0) {
+        setvbuf(telemetry->file, NULL, _IOFBF, buffer);
+    }
+    fprintf(telemetry->file, "time,ready_queue,waiting_queue,running_queue,cpu_busy_fraction,used_memory,used_partitions\n");
+    return true;
+}
+
+/**
+ * Records the gauges at the end of a tick if a sample is due.
+ * The queue sizes are read from the queues directly, so each tick costs O(1) whether or not a sample is written.
+ *
+ * @param telemetry   A pointer to the telemetry sampler.
+ * @param clock       The current time.
+ * @param sim         A pointer to the simulation being sampled.
+ * @param last        true if the simulation ends or pauses after this tick, so the ticks since the last sample are written even if the interval is not over.
+ */
+void sample_telemetry(telemetry_t *telemetry, int clock, const simulation_t *sim, bool last) {
+    int ready = sim->ready_queue->size;
+    int waiting = sim->waiting_queue->size;
+    int running = sim->running_queue->size;
+    int used_memory = 0, used_partitions = 0;
+    for (int i = 0; i < 4; i++) {
+        used_memory += sim->memory_management[i]->partition_used;
+        used_partitions += sim->memory_management[i]->used;
+    }
+
+    // The CPU is busy until the next tick if a PCB was dispatched or kept in the running state
+    telemetry->ticks++;
+    if (running != 0) {
+        telemetry->busy_ticks++;
+    }
+
+    bool record;
+    if (telemetry->interval > 0) {
+        record = (clock % telemetry->interval == 0 || last);
+    }
+    else {
+        record = (ready != telemetry->last_ready || waiting != telemetry->last_waiting || running != telemetry->last_running || used_memory != telemetry->last_memory);
+    }
+
+    if (record) {
+        fprintf(telemetry->file, "%d,%d,%d,%d,%.3f,%d,%d\n", clock, ready, waiting, running, (float)telemetry->busy_ticks / telemetry->ticks, used_memory, used_partitions);
+        telemetry->busy_ticks = 0;
+        telemetry->ticks = 0;
+        telemetry->last_ready = ready;
+        telemetry->last_waiting = waiting;
+        telemetry->last_running = running;
+        telemetry->last_memory = used_memory;
+    }
+}
+
+/**
+ * Closes the telemetry file.
+ *
+ * @param telemetry   A pointer to the telemetry sampler.
+ */
+void close_telemetry(telemetry_t *telemetry) {
+    if (telemetry->file != NULL) {
+        fclose(telemetry->file);
+        telemetry->file = NULL;
+    }
+}
 
 /**
  * This function simulates an OS kernel, processing PCB state transitions.
  * 
- * @param new_queue    A pointer to the queue containing PCBs to process.
- * @param filename     The name of the output file for logging state transitions.
+ * The simulation continues from the state in sim, which is either a new simulation or one restored from a checkpoint.
+ * 
+ * @param sim          A pointer to the simulation to run.
+ * @param trace        A pointer to the transition log.
+ * @param checkpoint   A pointer to the checkpoint settings.
+ * @param telemetry    A pointer to the telemetry sampler, or NULL to run without telemetry.
+ * @return             true if all PCBs terminated, false if the simulation was paused.
  */
-void flow_process(queue_t *new_queue, const char *filename, int size[]){
-    queue_t *ready_queue = alloc_queue();
-    queue_t *running_queue = alloc_queue();
-    queue_t *waiting_queue = alloc_queue();
-    queue_t *terminated_queue = alloc_queue();
-
-    memory_t** memory_management;   // A pointer to the memory table
-    node_t *current;                // A pointer to the current node in the loop
-    node_t *removed;                // A pointer to the node being removed
-    int running_time = 0;           // The running time of the PCB in the running state
-    int pcb_num = new_queue->size;  // The number of PCBs, which is the size of the new_queue
-    int clock = 0;                  // The timer
-    
-    memory_management = MemoryManagement(size);
+bool flow_process(simulation_t *sim, trace_t *trace, const checkpoint_t *checkpoint, telemetry_t *telemetry){
+    queue_t *new_queue = sim->new_queue;
+    queue_t *ready_queue = sim->ready_queue;
+    queue_t *running_queue = sim->running_queue;
+    queue_t *waiting_queue = sim->waiting_queue;
+    queue_t *terminated_queue = sim->terminated_queue;
+
+    memory_t** memory_management = sim->memory_management;   // A pointer to the memory table
+    node_t *current = NULL;                                  // A pointer to the current node in the loop
+    node_t *removed = NULL;                                  // A pointer to the node being removed
+    int running_time = sim->running_time;                    // The running time of the PCB in the running state
+    int pcb_num = sim->pcb_num;                              // The number of PCBs in the simulation
+    int clock = sim->clock;                                  // The timer
+    int start_clock = clock;                                 // The time the simulation started or resumed at
 
     // The while loop won't stop until all PCBs are terminated.
     while(terminated_queue->size < pcb_num){
 
+        // Save the state at the start of the tick if a checkpoint is due, and pause the simulation if the stop time is reached
+        if (checkpoint->filename != NULL) {
+            bool stop = (clock == checkpoint->stop_time);
+            bool due = (checkpoint->interval > 0 && clock != start_clock && clock % checkpoint->interval == 0);
+            if (checkpoint->filename != NULL && (stop || due)) {
+                sim->clock = clock;
+                sim->running_time = running_time;
+                if (trace->mode == LOG_BINARY) {
+                    flush_trace(trace); // Keep the trace on disk consistent with the checkpoint
+                }
+                save_checkpoint(sim, checkpoint->filename);
+            }
+            if (stop) {
+                return false;
+            }
+        }
+
         // Check for PCBs in the new queue and transition them to the ready state if their arrival time is less than or equal to the current clock time 
         // and there is available memory for the process
         if (new_queue->size != 0) {
@@ -343,7 +924,7 @@ void flow_process(queue_t *new_queue, const char *filename, int size[]){
 
                             // Allocate memory for the PCB
                             allocate_memory(memory_management[j], removed->pcb);
-                            write_text_file(filename, clock, removed->pcb, memory_management, "New", "Ready");
+                            log_transition(trace, clock, removed->pcb, memory_management, STATE_NEW, STATE_READY);
                             current = next; // Move to the next PCB after memory allocation
                             done = true;
                             break;
@@ -399,7 +980,7 @@ void flow_process(queue_t *new_queue, const char *filename, int size[]){
                 // Deallocate memory associated with the terminated PCB
                 int index = removed->pcb->memory_position;
                 deallocate_memory(memory_management[index]);
-                write_text_file(filename, clock, removed->pcb, memory_management, "Running", "Terminated");
+                log_transition(trace, clock, removed->pcb, memory_management, STATE_RUNNING, STATE_TERMINATED);
                 // Reset the memory position to -1
                 removed->pcb->memory_position = -1;
             }
@@ -420,10 +1001,19 @@ void flow_process(queue_t *new_queue, const char *filename, int size[]){
             }
         }
 
+        // Samples the queue depths and the CPU utilisation at the end of the tick, and the last partial interval before the simulation ends or pauses
+        if (telemetry != NULL) {
+            bool last = (terminated_queue->size == pcb_num || (checkpoint->filename != NULL && clock + 1 == checkpoint->stop_time));
+            sample_telemetry(telemetry, clock, sim, last);
+        }
+
         // Increments the timer after each loop
         clock++; 
     }
 
+    sim->clock = clock;
+    sim->running_time = running_time;
+
     // Deallocates memory after jobs are terminated 
     free(ready_queue);
     free(waiting_queue);
@@ -431,34 +1021,434 @@ void flow_process(queue_t *new_queue, const char *filename, int size[]){
     free(terminated_queue);
     free(current);
     free(removed);
+    return true;
 }
 
-int main(int argc, char *argv[]){
+/**
+ * Prints the command line options of the simulator.
+ *
+ * @param program   The name the program was started with.
+ */
+void print_usage(const char *program) {
+    printf("Usage: %s [options] [INPUT OUTPUT PARTITIONS]\n", program);
+    printf("       %s render TRACE OUTPUT\n\n", program);
+    printf("Options (every option can also be set as 'name = value' in the config file):\n");
+    printf("  --config FILE                Read options from FILE, options on the command line take precedence\n");
+    printf("  --input FILE                 The CSV file with the PCBs\n");
+    printf("  --output FILE                The file the state transitions are logged to\n");
+    printf("  --partitions LAYOUT          size1 (500,250,150,100), size2 (300,300,350,50) or four sizes such as 400,300,200,100\n");
+    printf("  --log MODE                   text, binary or none (text)\n");
+    printf("  --trace-buffer N             The number of records buffered by the binary trace (%d)\n", TRACE_BUFFER_RECORDS);
+    printf("  --checkpoint FILE            Save checkpoints to FILE\n");
+    printf("  --checkpoint-interval MS     Save a checkpoint every MS ms (0, only when stopping)\n");
+    printf("  --stop TIME                  Save a checkpoint and pause the simulation at TIME\n");
+    printf("  --resume FILE                Continue the simulation saved in FILE instead of reading an input file\n");
+    printf("  --telemetry FILE             Sample the queue sizes, the memory usage and the CPU utilisation to FILE\n");
+    printf("  --telemetry-interval MS      Sample every MS ms (0, whenever a gauge changes)\n");
+    printf("  --telemetry-buffer BYTES     The size of the buffer of the telemetry file\n");
+    printf("  --help                       Print this message\n");
+}
+
+/**
+ * Parses a whole string as a decimal integer within a range.
+ *
+ * @param text      The string to parse.
+ * @param minimum   The smallest accepted value.
+ * @param maximum   The largest accepted value.
+ * @param value     A pointer to the parsed value.
+ * @return          true if the string is an integer within the range, false otherwise.
+ */
+bool parse_int(const char *text, long minimum, long maximum, int *value) {
+    char *end;
+    errno = 0;
+    long parsed = strtol(text, &end, 10);
+    if (end == text || *end != '\0' || errno != 0 || parsed < minimum || parsed > maximum) {
+        return false;
+    }
+    *value = (int)parsed;
+    return true;
+}
+
+/**
+ * Parses a partition layout, either one of the named layouts or four comma-separated partition sizes.
+ *
+ * @param text   The layout to parse.
+ * @param size   An array receiving the sizes of the four partitions.
+ * @return       true if the layout is valid, false otherwise.
+ */
+bool parse_partitions(const char *text, int size[]) {
+    static const int size1[4] = {500, 250, 150, 100};
+    static const int size2[4] = {300, 300, 350, 50};
+    if (strcmp(text, "size1") == 0 || strcmp(text, "size2") == 0) {
+        memcpy(size, (text[4] == '1') ? size1 : size2, sizeof(size1));
+        return true;
+    }
+
+    char copy[128];
+    if (strlen(text) >= sizeof(copy)) {
+        return false;
+    }
+    strcpy(copy, text);
+    char *field = copy;
+    for (int i = 0; i < 4; i++) {
+        char *comma = strchr(field, ',');
+        if ((comma == NULL) != (i == 3)) {
+            return false;
+        }
+        if (comma != NULL) {
+            *comma = '\0';
+        }
+        if (!parse_int(field, 1, INT_MAX, &size[i])) {
+            return false;
+        }
+        field = comma + 1;
+    }
+    return true;
+}
+
+/**
+ * Sets one option of the configuration from its name and value.
+ *
+ * @param config   A pointer to the configuration.
+ * @param name     The long name of the option, without the leading dashes.
+ * @param value    The value of the option.
+ * @return         true if the option is known and its value is valid, false otherwise.
+ */
+bool set_option(config_t *config, const char *name, const char *value) {
+    if (value == NULL) {
+        printf("Error: option --%s needs a value\n", name);
+        return false;
+    }
+
+    bool valid = true;
+    if (strcmp(name, "input") == 0) {
+        config->input = value;
+    }
+    else if (strcmp(name, "output") == 0) {
+        config->output = value;
+    }
+    else if (strcmp(name, "partitions") == 0) {
+        valid = parse_partitions(value, config->partitions);
+        config->partitions_set = true;
+    }
+    else if (strcmp(name, "log") == 0) {
+        if (strcmp(value, "text") == 0) {
+            config->log_mode = LOG_TEXT;
+        }
+        else if (strcmp(value, "binary") == 0) {
+            config->log_mode = LOG_BINARY;
+        }
+        else if (strcmp(value, "none") == 0) {
+            config->log_mode = LOG_NONE;
+        }
+        else {
+            valid = false;
+        }
+    }
+    else if (strcmp(name, "trace-buffer") == 0) {
+        valid = parse_int(value, 1, 1 << 24, &config->trace_buffer);
+    }
+    else if (strcmp(name, "telemetry-buffer") == 0) {
+        valid = parse_int(value, 1, 1 << 30, &config->file_buffer);
+    }
+    else if (strcmp(name, "checkpoint") == 0) {
+        config->checkpoint.filename = value;
+    }
+    else if (strcmp(name, "checkpoint-interval") == 0) {
+        valid = parse_int(value, 0, INT_MAX, &config->checkpoint.interval);
+    }
+    else if (strcmp(name, "stop") == 0) {
+        valid = parse_int(value, 0, INT_MAX, &config->checkpoint.stop_time);
+    }
+    else if (strcmp(name, "resume") == 0) {
+        config->resume = value;
+    }
+    else if (strcmp(name, "telemetry") == 0) {
+        config->telemetry = value;
+    }
+    else if (strcmp(name, "telemetry-interval") == 0) {
+        valid = parse_int(value, 0, INT_MAX, &config->telemetry_interval);
+        config->telemetry_interval_set = true;
+    }
+    else {
+        printf("Error: unknown option --%s\n", name);
+        return false;
+    }
+
+    if (!valid) {
+        printf("Error: invalid value '%s' for --%s\n", value, name);
+    }
+    return valid;
+}
+
+/**
+ * Reads options from a config file. Every line holds one 'name = value' pair with the long name of an option,
+ * and everything after a '#' is a comment.
+ *
+ * @param config     A pointer to the configuration.
+ * @param filename   The name of the config file.
+ * @return           true if the file was read and all of its options are valid, false otherwise.
+ */
+bool load_config_file(config_t *config, const char *filename) {
+    FILE *file = fopen(filename, "r");
+    if (file == NULL) {
+        printf("Error opening file %s\n", filename);
+        return false;
+    }
+
+    char line[1024];
+    int line_number = 0;
+    bool valid = true;
+    while (valid && fgets(line, sizeof(line), file) != NULL) {
+        line_number++;
+        char *comment = strchr(line, '#');
+        if (comment != NULL) {
+            *comment = '\0';
+        }
+
+        // Split the line at the '=' and trim the white space around the name and the value
+        char *name = line;
+        while (*name == ' ' || *name == '\t') {
+            name++;
+        }
+        if (*name == '\0' || *name == '\n' || *name == '\r') {
+            continue;
+        }
+        char *value = strchr(name, '=');
+        if (value == NULL) {
+            printf("Error in %s line %d: expected 'name = value'\n", filename, line_number);
+            valid = false;
+            break;
+        }
+        char *end = value;
+        *value++ = '\0';
+        while (end > name && (end[-1] == ' ' || end[-1] == '\t')) {
+            *--end = '\0';
+        }
+        while (*value == ' ' || *value == '\t') {
+            value++;
+        }
+        end = value + strlen(value);
+        while (end > value && (end[-1] == ' ' || end[-1] == '\t' || end[-1] == '\n' || end[-1] == '\r')) {
+            *--end = '\0';
+        }
+
+        // The configuration keeps pointers to the path values, so every value gets its own copy
+        size_t length = strlen(value) + 1;
+        char *copy = malloc(length);
+        assert(copy != NULL);
+        memcpy(copy, value, length);
+        if (!set_option(config, name, copy)) {
+            printf("Error in %s line %d\n", filename, line_number);
+            valid = false;
+        }
+    }
 
-    queue_t *new_queue = alloc_queue();
-    new_queue = read_CSV_file(argv[1]);
-    FILE *file = fopen(argv[2], "w");
-    fprintf(file, "%-8s %-8s %-25s %-25s %-20s %-20s %-23s %-18s %-18s %-15s %-15s\n", "Time", "PID", "Partition # of Entry", "Partition # of Removal", "Total Used Memory", "Total Free Memory", "Total Usable Memory", "Used Partitions", "Free Partitions", "Old State", "New State");
     fclose(file);
+    return valid;
+}
 
-    int size[4];
+/**
+ * Rejects missing settings and combinations of options that cannot be used together, before anything is simulated.
+ *
+ * @param config   A pointer to the configuration.
+ * @return         true if the configuration can be run, false otherwise.
+ */
+bool validate_config(const config_t *config) {
+    const char *error = NULL;
 
-    if (strcmp(argv[3], "size1") == 0) {
-        size[0] = 500;
-        size[1] = 250;
-        size[2] = 150;
-        size[3] = 100;
-    } else {
-        size[0] = 300;
-        size[1] = 300;
-        size[2] = 350;
-        size[3] = 50;
+    if (config->input == NULL && config->resume == NULL) {
+        error = "an input file (--input) or a checkpoint to resume (--resume) is required";
     }
+    else if (config->input != NULL && config->resume != NULL) {
+        error = "--input and --resume cannot be used together, a resumed simulation takes its PCBs from the checkpoint";
+    }
+    else if (config->resume == NULL && !config->partitions_set) {
+        error = "a partition layout (--partitions) is required";
+    }
+    else if (config->resume != NULL && config->partitions_set) {
+        error = "--partitions cannot be used with --resume, the memory table is restored from the checkpoint";
+    }
+    else if (config->output == NULL && config->log_mode != LOG_NONE) {
+        error = "an output file (--output) is required unless --log none is given";
+    }
+    else if (config->output != NULL && config->log_mode == LOG_NONE) {
+        error = "--output cannot be used with --log none";
+    }
+    else if (config->trace_buffer != TRACE_BUFFER_RECORDS && config->log_mode != LOG_BINARY) {
+        error = "--trace-buffer can only be used with --log binary";
+    }
+    else if (config->checkpoint.filename == NULL && (config->checkpoint.interval > 0 || config->checkpoint.stop_time >= 0)) {
+        error = "--checkpoint-interval and --stop need a checkpoint file (--checkpoint)";
+    }
+    else if (config->telemetry == NULL && (config->telemetry_interval_set || config->file_buffer > 0)) {
+        error = "--telemetry-interval and --telemetry-buffer need a telemetry file (--telemetry)";
+    }
+
+    if (error != NULL) {
+        printf("Error: %s\n", error);
+        return false;
+    }
+    return true;
+}
 
-    flow_process(new_queue, argv[2], size);
+/**
+ * Reads the configuration from the command line and the optional config file.
+ * Options are given as '--name value' or '--name=value', and the legacy positional form INPUT OUTPUT PARTITIONS is still accepted.
+ *
+ * @param config   A pointer to the configuration to fill.
+ * @param argc     The number of command line arguments.
+ * @param argv     The command line arguments.
+ * @return         true if the configuration is complete and valid, false otherwise.
+ */
+bool parse_arguments(config_t *config, int argc, char *argv[]) {
+    const config_t defaults = {
+        .log_mode = LOG_TEXT,
+        .trace_buffer = TRACE_BUFFER_RECORDS,
+        .checkpoint = {NULL, 0, -1},
+    };
+    *config = defaults;
 
-    free(new_queue);
-    free(file);
+    // The config file is read first, so every option given on the command line overrides it
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--config") == 0 || strncmp(argv[i], "--config=", 9) == 0) {
+            const char *filename = (argv[i][8] == '=') ? &argv[i][9] : (i + 1 < argc ? argv[i + 1] : NULL);
+            if (filename == NULL) {
+                printf("Error: option --config needs a value\n");
+                return false;
+            }
+            if (!load_config_file(config, filename)) {
+                return false;
+            }
+        }
+    }
+
+    const char *positional_names[] = {"input", "output", "partitions"};
+    int positional = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--", 2) != 0) {
+            if (positional == 3) {
+                printf("Error: unexpected argument '%s'\n", argv[i]);
+                return false;
+            }
+            if (!set_option(config, positional_names[positional++], argv[i])) {
+                return false;
+            }
+            continue;
+        }
+
+        char name[64];
+        const char *value = NULL;
+        const char *equals = strchr(argv[i], '=');
+        size_t length = (equals != NULL) ? (size_t)(equals - argv[i]) - 2 : strlen(argv[i]) - 2;
+        if (length >= sizeof(name)) {
+            printf("Error: unknown option %s\n", argv[i]);
+            return false;
+        }
+        memcpy(name, argv[i] + 2, length);
+        name[length] = '\0';
+
+        if (equals != NULL) {
+            value = equals + 1;
+        }
+        else if (i + 1 < argc) {
+            value = argv[++i];
+        }
+
+        if (strcmp(name, "config") == 0) {
+            continue; // Already read
+        }
+        if (!set_option(config, name, value)) {
+            return false;
+        }
+    }
+
+    return validate_config(config);
+}
+
+int main(int argc, char *argv[]){
+
+    // Convert a binary trace produced by an earlier run into the text output layout
+    if (argc == 4 && strcmp(argv[1], "render") == 0) {
+        return render_trace(argv[2], argv[3]) ? 0 : 1;
+    }
+
+    trace_t trace;
+    config_t config;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--help") == 0) {
+            print_usage(argv[0]);
+            return 0;
+        }
+    }
+    if (argc < 2) {
+        print_usage(argv[0]);
+        return 1;
+    }
+    if (!parse_arguments(&config, argc, argv)) {
+        printf("Run %s --help for the list of options\n", argv[0]);
+        return 1;
+    }
+
+    int *size = config.partitions;
+
+    // A resumed simulation takes all of its PCBs and its memory table from the checkpoint instead of the input file
+    simulation_t *sim;
+    if (config.resume != NULL) {
+        sim = load_checkpoint(config.resume);
+        if (sim != NULL) {
+            for (int i = 0; i < 4; i++) {
+                size[i] = sim->memory_management[i]->memory_size;
+            }
+        }
+    }
+    else {
+        queue_t *new_queue = read_CSV_file(config.input);
+        if (new_queue == NULL) {
+            return 1;
+        }
+
+        // A PCB that does not fit in any partition would never leave the new queue, so the simulation would never end
+        int largest = 0;
+        for (int i = 0; i < 4; i++) {
+            largest = (size[i] > largest) ? size[i] : largest;
+        }
+        node_t *current = new_queue->front;
+        for (int i = 0; i < new_queue->size; i++) {
+            if (current->pcb->memory_needed > largest) {
+                printf("Error: PCB %d needs %d of memory, more than the largest partition (%d)\n", current->pcb->pid, current->pcb->memory_needed, largest);
+                return 1;
+            }
+            current = current->next;
+        }
+        sim = new_simulation(new_queue, size);
+    }
+    if (sim == NULL) {
+        return 1;
+    }
+
+    if (!open_trace(&trace, config.output, config.log_mode, sim->memory_management, config.trace_buffer)) {
+        return 1;
+    }
+
+    telemetry_t telemetry;
+    if (config.telemetry != NULL && !open_telemetry(&telemetry, config.telemetry, config.telemetry_interval, config.file_buffer)) {
+        return 1;
+    }
+
+    bool finished = flow_process(sim, &trace, &config.checkpoint, config.telemetry != NULL ? &telemetry : NULL);
+
+    close_trace(&trace);
+    if (config.telemetry != NULL) {
+        close_telemetry(&telemetry);
+    }
+
+    if (!finished) {
+        printf("Simulation paused at time %d, checkpoint saved to %s\n", sim->clock, config.checkpoint.filename);
+    }
+
+    free(sim->new_queue);
 
     return 0;
-}
\ No newline at end of file
+}
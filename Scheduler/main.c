@@ -10,8 +10,72 @@
 #include <string.h>
 #include <stdio.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <math.h>
+#include <pthread.h>
+#include <errno.h>
+#include <limits.h>
 #include <assert.h>
 
+// The vectorized tick kernels are built for x86 with GCC or Clang, every other target uses the scalar kernels only
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define TICK_KERNELS_X86
+#endif
+
+// Forces a function to be inlined into every caller, so a constant argument specializes its body in each of them
+#if defined(__GNUC__)
+#define ALWAYS_INLINE inline __attribute__((always_inline))
+#else
+#define ALWAYS_INLINE inline
+#endif
+
+#define TRACE_BUFFER_RECORDS 4096   // The default number of records buffered before the binary trace is flushed to its file
+#define TRACE_MAGIC "SCHTRC1"       // The magic string identifying a Scheduler binary trace file
+#define CHECKPOINT_MAGIC "SCHCKP1"  // The magic string identifying a Scheduler checkpoint file
+#define MLFQ_LEVELS 8               // The number of priority levels of the multilevel feedback queue (at most 32)
+#define MLFQ_BASE_QUANTUM 10        // The default time quantum of the highest level, each lower level has twice the quantum of the level above
+#define MLFQ_BOOST_INTERVAL 1000    // The interval at which all PCBs are moved back to the highest level
+#define MAX_DEVICES 64              // The largest number of I/O devices
+#define ENSEMBLE_ALGORITHMS 4       // The number of scheduling algorithms compared by an ensemble
+#define ENSEMBLE_METRICS 3          // The number of metrics aggregated by an ensemble
+
+// Defines the states a PCB can be in
+typedef enum {
+    STATE_NEW,
+    STATE_READY,
+    STATE_RUNNING,
+    STATE_WAITING,
+    STATE_TERMINATED
+} state_t;
+
+// The names of the states as they appear in the text output
+const char *state_names[] = {"New", "Ready", "Running", "Waiting", "Terminated"};
+
+// Defines the scheduling algorithms
+typedef enum {
+    ALG_FCFS,
+    ALG_ROUND_ROBIN,
+    ALG_PRIORITY,
+    ALG_MLFQ
+} algorithm_t;
+
+// The names of the algorithms as they are given on the command line
+const char *algorithm_names[] = {"FCFS", "RoundRobin", "Priority", "MLFQ"};
+
+// Defines the orders in which an I/O device serves its requests
+typedef enum {
+    IO_FIFO,       // In the order the requests arrive
+    IO_ELEVATOR    // The nearest request in the direction the head moves, reversing at the last request (elevator algorithm)
+} io_policy_t;
+
+// Defines the ways the state transitions can be logged
+typedef enum {
+    LOG_TEXT,     // Every transition is formatted and appended to the output file as it happens
+    LOG_BINARY,   // Every transition is stored as a fixed-size record and rendered to text later
+    LOG_NONE      // The transitions are not logged, only the metrics are calculated
+} log_mode_t;
+
 // Defines a structure for the Process Control Block (PCB) with the necessary information
 typedef struct pcb {	
     int pid;                     // Process ID
@@ -32,6 +96,12 @@ typedef struct pcb {
     int ready_waiting_time;      // Total time the process has spent waiting in the ready state
     int start_time;              // Start time when the process started executing
     int end_time;                // End time of the process
+    int level;                   // Level of the process in the multilevel feedback queue (MLFQ scheduling only)
+    int quantum_used;            // Time the process has run since it entered its current level (MLFQ scheduling only)
+    int switch_remaining;        // Time the CPU still spends on the context switch to the process before it runs
+    int device;                  // I/O device the process uses (only when the I/O devices are modelled)
+    int track;                   // Track of the device the I/O requests of the process access
+    int io_service;              // Service time of the I/O request being served by the device
 } pcb_t;
 
 
@@ -48,6 +118,157 @@ typedef struct {
     int size;
 } queue_t;
 
+// Defines a dense array copy of a queue used by the dense tick mode, so the per-tick work runs over contiguous memory instead of linked nodes
+typedef struct {
+    node_t **nodes;   // The nodes in queue order
+    int *values;      // The value each tick kernel works on (the waiting time in the waiting queue, the priority in the ready queue)
+    int *limits;      // The value the waiting time is compared with (the I/O duration), unused in the ready queue
+    uint32_t *mask;   // One bit per entry, set by the waiting kernel for each PCB that finished its I/O
+    int head;         // The index of the first entry, the entries before it were taken from the front of the queue
+    int holes;        // The number of entries after head that were taken from the middle of the queue (node NULL, value INT_MAX)
+    int size;
+    int capacity;
+} dense_queue_t;
+
+// Defines the set of tick kernels selected for the processor the simulation runs on
+typedef struct {
+    const char *name;
+    void (*tick_waiting)(int *waited, const int *limits, int n, uint32_t *mask);
+    int (*argmin)(const int *values, int n);
+} tick_kernels_t;
+
+// Defines an I/O device with its own queue of requests
+typedef struct {
+    queue_t *queue;      // The waiting PCBs using the device, the front PCB is being served whenever the queue is not empty
+    int head;            // The track the head of the device is on
+    int direction;       // The direction the head moves in, 1 towards higher tracks or -1 (elevator scheduling only)
+    int busy_ticks;      // The number of ticks the device spent serving requests
+    int requests;        // The number of requests served
+} device_t;
+
+// Defines a structure holding the complete state of a simulation, which is everything a checkpoint has to save
+typedef struct {
+    queue_t *new_queue;
+    queue_t *ready_queue;
+    queue_t *running_queue;
+    queue_t *waiting_queue;
+    queue_t *terminated_queue;
+    queue_t *levels[MLFQ_LEVELS];   // The ready queues of the levels of the multilevel feedback queue (MLFQ scheduling only)
+    uint32_t level_bitmap;          // Bit i is set if levels[i] is not empty
+    int size;     // The number of PCBs in the simulation
+    int clock;    // The timer
+    int switch_time;           // The CPU time spent on context switches and kernel overhead instead of running PCBs
+    int pending_transitions;   // The transitions since the last dispatch, their kernel overhead is charged to the next dispatch
+    device_t devices[MAX_DEVICES];  // The I/O devices, whose queues hold the waiting PCBs when the devices are modelled
+    int device_count;          // The number of I/O devices, or 0 if every waiting PCB does its I/O in parallel
+} simulation_t;
+
+// Defines when the state of a simulation is saved to a checkpoint file and when the simulation is paused
+typedef struct {
+    const char *filename;   // The name of the checkpoint file, or NULL if no checkpoints are saved
+    int interval;           // A checkpoint is saved every interval ticks (0 to disable)
+    int stop_time;          // The simulation is paused at this time after saving a checkpoint (-1 to run to the end)
+} checkpoint_t;
+
+// Defines the settings of a run, read from the command line and the optional config file
+typedef struct {
+    const char *input;          // The name of the input CSV file
+    const char *output;         // The name of the output file for the state transitions
+    const char *metrics;        // The name of the output file for the metrics
+    algorithm_t algorithm;      // The scheduling algorithm
+    bool algorithm_set;         // true if the algorithm was given
+    int quantum;                // The time quantum of RoundRobin or of the highest MLFQ level (0 for the default of the algorithm)
+    int cpus;                   // The number of CPUs
+    int switch_cost;            // The CPU time of a context switch to a dispatched PCB
+    int transition_overhead;    // The CPU time the kernel spends on every state transition
+    int devices;                // The number of I/O devices (0 for unlimited parallel I/O)
+    io_policy_t io_policy;      // The order in which the devices serve their requests
+    bool io_policy_set;         // true if the I/O scheduling was given
+    int seek_time;              // The time the head of a device takes to move by one track
+    log_mode_t log_mode;        // How the state transitions are logged
+    bool log_mode_set;          // true if the log mode was given
+    int trace_buffer;           // The number of records buffered by the binary trace
+    int file_buffer;            // The size in bytes of the buffer of the telemetry file (0 for the default)
+    checkpoint_t checkpoint;    // When checkpoints are saved and the simulation is paused
+    const char *resume;         // The name of the checkpoint file to resume from, or NULL
+    const char *telemetry;      // The name of the telemetry file, or NULL
+    int telemetry_interval;     // A telemetry sample is recorded every telemetry_interval ticks, or on change if 0
+    bool telemetry_interval_set;// true if the telemetry interval was given
+    bool dense_tick;            // true to run in the dense tick mode
+    int replicas;               // The number of ensemble replicas (0 for a single run)
+    uint64_t seed;              // The seed of the ensemble random streams
+    double spread;              // The maximum relative change of the ensemble workloads
+    int threads;                // The number of threads running ensemble replicas
+    bool ensemble_option_set;   // true if the seed, spread or threads were given
+} config_t;
+
+// Defines the header written at the start of a checkpoint file
+typedef struct {
+    char magic[8];          // CHECKPOINT_MAGIC
+    int32_t pcb_size;       // sizeof(pcb_t), used to reject checkpoints from an incompatible build
+    int32_t clock;          // The timer
+    int32_t switch_time;    // The CPU time spent on context switches and kernel overhead
+    int32_t pending_transitions; // The transitions whose kernel overhead is not charged yet
+    int32_t device_count;   // The number of I/O devices, their state is saved after the PCBs
+    int32_t queue_sizes[5]; // The sizes of the new, ready (including the MLFQ levels), running, waiting and terminated queues
+} checkpoint_header_t;
+
+// Defines a structure for sampling the queue depths and the CPU utilisation over simulated time
+typedef struct {
+    FILE *file;          // The open telemetry file, or NULL if no telemetry is recorded
+    int interval;        // A sample is recorded every interval ticks, or whenever a gauge changes if 0
+    int cpus;            // The number of CPUs
+    int busy_ticks;      // The number of busy CPU ticks since the last sample
+    int ticks;           // The number of ticks since the last sample
+    int last_ready;      // The size of the ready queue in the last sample
+    int last_waiting;    // The size of the waiting queue in the last sample
+    int last_running;    // The size of the running queue in the last sample
+} telemetry_t;
+
+// Defines the settings and the results of an ensemble of randomized replicas of a workload
+typedef struct {
+    const pcb_t *workload;    // The PCBs read from the input file
+    int pcb_count;            // The number of PCBs in the workload
+    int replicas;             // The number of randomized replicas
+    uint64_t seed;            // The seed from which the random stream of every replica is derived
+    double spread;            // The maximum relative change of the arrival times, CPU times and I/O durations
+    const config_t *config;   // The settings every replica is simulated with, apart from the algorithm
+    int thread_count;         // The number of threads running replicas
+    float *results;           // The metrics of every replica and algorithm, indexed by replica, algorithm then metric
+} ensemble_t;
+
+// Defines the work of one ensemble thread, which runs every thread_count-th replica starting at index
+typedef struct {
+    ensemble_t *ensemble;
+    int index;
+} ensemble_worker_t;
+
+// Defines a fixed-size record for one state transition in the binary trace
+typedef struct {
+    int32_t time;         // The time at which the PCB switches states
+    int32_t pid;          // The process ID
+    uint8_t old_state;    // The old state of the PCB (a state_t value)
+    uint8_t new_state;    // The new state of the PCB (a state_t value)
+    int16_t partition;    // The memory partition of the PCB (always -1 in the Scheduler)
+    int32_t memory;       // The memory needed by the PCB (always 0 in the Scheduler)
+} trace_record_t;
+
+// Defines the header written at the start of a binary trace file
+typedef struct {
+    char magic[8];          // TRACE_MAGIC
+    int32_t record_size;    // sizeof(trace_record_t), used to reject traces from an incompatible build
+} trace_header_t;
+
+// Defines a structure for the transition log of a simulation
+typedef struct {
+    log_mode_t mode;          // How the transitions are logged
+    const char *filename;     // The name of the output file
+    FILE *file;               // The open output file (binary mode only)
+    trace_record_t *buffer;   // The records not yet written to the file (binary mode only)
+    int count;                // The number of records in the buffer
+    int capacity;             // The number of records the buffer can hold
+} trace_t;
+
 // This function allocates a queue on the heap and returns a pointer to it
 queue_t *alloc_queue(void) {
     queue_t *queue = malloc(sizeof(queue_t));  
@@ -90,6 +311,12 @@ pcb_t *new_pcb(int pid, int arrival_time, int total_CPU_time, int io_freq, int i
     pcb->ready_waiting_time = 0;
     pcb->start_time = -1;
     pcb->end_time = 0;
+    pcb->level = (priority < 0) ? 0 : (priority >= MLFQ_LEVELS) ? MLFQ_LEVELS - 1 : priority; // The priority sets the initial level
+    pcb->quantum_used = 0;
+    pcb->switch_remaining = 0;
+    pcb->device = 0;
+    pcb->track = 0;
+    pcb->io_service = 0;
     return pcb;
 }
 
@@ -166,17 +393,311 @@ node_t *dequeueNode(queue_t *queue, node_t *nodeToRemove) {
     return NULL;
 }
 
+/**
+ * This function allocates a dense queue on the heap with room for a fixed number of entries.
+ *
+ * @param capacity   The maximum number of entries, which is the number of PCBs in the simulation.
+ * @return           A pointer to the dense queue created.
+ */
+dense_queue_t *alloc_dense_queue(int capacity) {
+    dense_queue_t *dense = malloc(sizeof(dense_queue_t));
+    assert(dense != NULL);
+    dense->nodes = malloc((capacity + 1) * sizeof(node_t *));
+    dense->values = malloc((capacity + 1) * sizeof(int));
+    dense->limits = malloc((capacity + 1) * sizeof(int));
+    dense->mask = malloc((capacity / 32 + 1) * sizeof(uint32_t));
+    assert(dense->nodes != NULL && dense->values != NULL && dense->limits != NULL && dense->mask != NULL);
+    dense->head = 0;
+    dense->holes = 0;
+    dense->size = 0;
+    dense->capacity = capacity;
+    return dense;
+}
+
+/**
+ * This function frees a dense queue. The nodes it points to are owned by the linked queues and are not freed.
+ *
+ * @param dense   A pointer to the dense queue to free.
+ */
+void free_dense_queue(dense_queue_t *dense) {
+    free(dense->nodes);
+    free(dense->values);
+    free(dense->limits);
+    free(dense->mask);
+    free(dense);
+}
+
+/**
+ * This function moves the entries of a dense queue to the start of its arrays, dropping the entries taken from it.
+ *
+ * @param dense   A pointer to the dense queue.
+ */
+void dense_compact(dense_queue_t *dense) {
+    int kept = 0;
+    for (int i = dense->head; i < dense->size; i++) {
+        if (dense->nodes[i] != NULL) {
+            dense->nodes[kept] = dense->nodes[i];
+            dense->values[kept] = dense->values[i];
+            dense->limits[kept] = dense->limits[i];
+            kept++;
+        }
+    }
+    dense->head = 0;
+    dense->holes = 0;
+    dense->size = kept;
+}
+
+/**
+ * This function appends an entry to the end of a dense queue.
+ *
+ * @param dense   A pointer to the dense queue.
+ * @param node    A pointer to the node of the PCB.
+ * @param value   The value the tick kernels work on.
+ * @param limit   The value the waiting time is compared with.
+ */
+void dense_push(dense_queue_t *dense, node_t *node, int value, int limit) {
+    if (dense->size == dense->capacity) {
+        dense_compact(dense);
+    }
+    assert(dense->size < dense->capacity);
+    dense->nodes[dense->size] = node;
+    dense->values[dense->size] = value;
+    dense->limits[dense->size] = limit;
+    dense->size++;
+}
+
+/**
+ * This function takes the entry at an index out of a dense queue in O(1), keeping the other entries in queue order.
+ * The front entry is taken by moving head, any other entry is left as a hole whose value of INT_MAX is never picked by
+ * the argmin kernel before a real entry. The arrays are compacted once there are more holes than entries.
+ *
+ * @param dense   A pointer to the dense queue.
+ * @param index   The index of the entry to take, at or after head.
+ * @return        A pointer to the node of the entry.
+ */
+node_t *dense_take(dense_queue_t *dense, int index) {
+    node_t *node = dense->nodes[index];
+    if (index == dense->head) {
+        dense->head++;
+    }
+    else {
+        dense->nodes[index] = NULL;
+        dense->values[index] = INT_MAX;
+        dense->holes++;
+    }
+    while (dense->head < dense->size && dense->nodes[dense->head] == NULL) {
+        dense->head++;
+        dense->holes--;
+    }
+    if (dense->holes > dense->size - dense->head - dense->holes) {
+        dense_compact(dense);
+    }
+    return node;
+}
+
+/**
+ * This function rebuilds the links of a queue so it holds the nodes of a dense queue in the same order.
+ *
+ * @param queue   A pointer to the queue to relink.
+ * @param dense   A pointer to the dense queue holding the nodes.
+ */
+void relink_queue(queue_t *queue, dense_queue_t *dense) {
+    dense_compact(dense);
+    for (int i = 0; i + 1 < dense->size; i++) {
+        dense->nodes[i]->next = dense->nodes[i + 1];
+    }
+    queue->size = dense->size;
+    queue->front = (dense->size != 0) ? dense->nodes[0] : NULL;
+    queue->rear = (dense->size != 0) ? dense->nodes[dense->size - 1] : NULL;
+    if (queue->rear != NULL) {
+        queue->rear->next = NULL;
+    }
+}
+
+/**
+ * This function increments the waiting time of every entry and sets the bit of each entry whose waiting time reached its limit.
+ *
+ * @param waited   The waiting times of the PCBs in the waiting queue.
+ * @param limits   The I/O durations of the PCBs in the waiting queue.
+ * @param n        The number of PCBs in the waiting queue.
+ * @param mask     The completion bitmask, one bit per PCB in queue order.
+ */
+void tick_waiting_scalar(int *waited, const int *limits, int n, uint32_t *mask) {
+    memset(mask, 0, (n / 32 + 1) * sizeof(uint32_t));
+    for (int i = 0; i < n; i++) {
+        waited[i]++;
+        if (waited[i] == limits[i]) {
+            mask[i / 32] |= 1u << (i % 32);
+        }
+    }
+}
+
+/**
+ * This function finds the first entry with the lowest value, which is the highest priority PCB in the ready queue.
+ *
+ * @param values   The priorities of the PCBs in the ready queue.
+ * @param n        The number of PCBs in the ready queue (at least 1).
+ * @return         The index of the first PCB with the highest priority.
+ */
+int argmin_scalar(const int *values, int n) {
+    int best = 0;
+    for (int i = 1; i < n; i++) {
+        if (values[best] > values[i]) {
+            best = i;
+        }
+    }
+    return best;
+}
+
+#ifdef TICK_KERNELS_X86
+// The SSE2 kernels process 4 PCBs per instruction
+__attribute__((target("sse2")))
+void tick_waiting_sse2(int *waited, const int *limits, int n, uint32_t *mask) {
+    memset(mask, 0, (n / 32 + 1) * sizeof(uint32_t));
+    const __m128i one = _mm_set1_epi32(1);
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128i w = _mm_add_epi32(_mm_loadu_si128((const __m128i *)(waited + i)), one);
+        _mm_storeu_si128((__m128i *)(waited + i), w);
+        __m128i done = _mm_cmpeq_epi32(w, _mm_loadu_si128((const __m128i *)(limits + i)));
+        mask[i / 32] |= (uint32_t)_mm_movemask_ps(_mm_castsi128_ps(done)) << (i % 32);
+    }
+    for (; i < n; i++) {
+        waited[i]++;
+        if (waited[i] == limits[i]) {
+            mask[i / 32] |= 1u << (i % 32);
+        }
+    }
+}
+
+__attribute__((target("sse2")))
+int argmin_sse2(const int *values, int n) {
+    if (n < 4) {
+        return argmin_scalar(values, n);
+    }
+
+    // SSE2 has no 32-bit minimum instruction, so it is built from a compare and a select
+    __m128i best = _mm_loadu_si128((const __m128i *)values);
+    int i = 4;
+    for (; i + 4 <= n; i += 4) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(values + i));
+        __m128i greater = _mm_cmpgt_epi32(best, v);
+        best = _mm_or_si128(_mm_and_si128(greater, v), _mm_andnot_si128(greater, best));
+    }
+    int lanes[4];
+    _mm_storeu_si128((__m128i *)lanes, best);
+    int min = lanes[0];
+    for (int k = 1; k < 4; k++) {
+        min = (lanes[k] < min) ? lanes[k] : min;
+    }
+    for (; i < n; i++) {
+        min = (values[i] < min) ? values[i] : min;
+    }
+
+    // The first PCB with the lowest value wins, as in the scalar scan
+    const __m128i target = _mm_set1_epi32(min);
+    for (i = 0; i + 4 <= n; i += 4) {
+        int bits = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(_mm_loadu_si128((const __m128i *)(values + i)), target)));
+        if (bits != 0) {
+            return i + __builtin_ctz(bits);
+        }
+    }
+    for (; i < n; i++) {
+        if (values[i] == min) {
+            return i;
+        }
+    }
+    return 0;
+}
+
+// The AVX2 kernels process 8 PCBs per instruction
+__attribute__((target("avx2")))
+void tick_waiting_avx2(int *waited, const int *limits, int n, uint32_t *mask) {
+    memset(mask, 0, (n / 32 + 1) * sizeof(uint32_t));
+    const __m256i one = _mm256_set1_epi32(1);
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i w = _mm256_add_epi32(_mm256_loadu_si256((const __m256i *)(waited + i)), one);
+        _mm256_storeu_si256((__m256i *)(waited + i), w);
+        __m256i done = _mm256_cmpeq_epi32(w, _mm256_loadu_si256((const __m256i *)(limits + i)));
+        mask[i / 32] |= (uint32_t)_mm256_movemask_ps(_mm256_castsi256_ps(done)) << (i % 32);
+    }
+    for (; i < n; i++) {
+        waited[i]++;
+        if (waited[i] == limits[i]) {
+            mask[i / 32] |= 1u << (i % 32);
+        }
+    }
+}
+
+__attribute__((target("avx2")))
+int argmin_avx2(const int *values, int n) {
+    if (n < 8) {
+        return argmin_scalar(values, n);
+    }
+
+    __m256i best = _mm256_loadu_si256((const __m256i *)values);
+    int i = 8;
+    for (; i + 8 <= n; i += 8) {
+        best = _mm256_min_epi32(best, _mm256_loadu_si256((const __m256i *)(values + i)));
+    }
+    int lanes[8];
+    _mm256_storeu_si256((__m256i *)lanes, best);
+    int min = lanes[0];
+    for (int k = 1; k < 8; k++) {
+        min = (lanes[k] < min) ? lanes[k] : min;
+    }
+    for (; i < n; i++) {
+        min = (values[i] < min) ? values[i] : min;
+    }
+
+    // The first PCB with the lowest value wins, as in the scalar scan
+    const __m256i target = _mm256_set1_epi32(min);
+    for (i = 0; i + 8 <= n; i += 8) {
+        int bits = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i *)(values + i)), target)));
+        if (bits != 0) {
+            return i + __builtin_ctz(bits);
+        }
+    }
+    for (; i < n; i++) {
+        if (values[i] == min) {
+            return i;
+        }
+    }
+    return 0;
+}
+#endif
+
+/**
+ * This function selects the widest tick kernels the processor supports, falling back to the scalar kernels.
+ *
+ * @return   The selected tick kernels.
+ */
+tick_kernels_t select_tick_kernels(void) {
+#ifdef TICK_KERNELS_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return (tick_kernels_t){"AVX2", tick_waiting_avx2, argmin_avx2};
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return (tick_kernels_t){"SSE2", tick_waiting_sse2, argmin_sse2};
+    }
+#endif
+    return (tick_kernels_t){"scalar", tick_waiting_scalar, argmin_scalar};
+}
+
 /** 
  * This function scans a CSV file, creates a PCB structure for each entry, enqueues them into a queue, and returns a pointer to the queue.
  * 
  * @param filename   The name of the input CSV file.
- * @return           A pointer to the queue containing PCB structures.
+ * @return           A pointer to the queue containing PCB structures, or NULL if the file cannot be read or a line is not a PCB.
  */
 queue_t *read_CSV_file(const char filename[]){
     pcb_t *pcb;
     node_t *p;
     queue_t *queue = alloc_queue();
-    int pid, arrivalTime, totalCpuTime, ioFrequency, ioDuration, priority;
+    int pid, arrivalTime, totalCpuTime, ioFrequency, ioDuration, priority, device, track;
+    int line = 1;
 
     FILE *file = fopen(filename, "r");
 
@@ -190,10 +711,29 @@ queue_t *read_CSV_file(const char filename[]){
     // Read a line of text from file and store it in buffer
     fgets(buffer, sizeof(buffer), file);
 
-    // Read data from the file in a loop as long as fscanf is able to extract all five integers from the line
-    while (fscanf(file, "%d,%d,%d,%d,%d,%d", &pid, &arrivalTime, &totalCpuTime, &ioFrequency, &ioDuration, &priority) == 6) {
+    // Read data from the file one line at a time, every line that is not blank must hold the six required integers,
+    // the I/O device and the track it accesses are optional seventh and eighth columns
+    while (fgets(buffer, sizeof(buffer), file) != NULL) {
+        line++;
+        if (strchr(buffer, '\n') == NULL && !feof(file)) {
+            printf("Error: line %d of %s is longer than %d characters\n", line, filename, (int)sizeof(buffer) - 2);
+            fclose(file);
+            return NULL;
+        }
+        if (buffer[strspn(buffer, " \t\r\n")] == '\0') {
+            continue;
+        }
+        device = 0;
+        track = 0;
+        if (sscanf(buffer, "%d,%d,%d,%d,%d,%d,%d,%d", &pid, &arrivalTime, &totalCpuTime, &ioFrequency, &ioDuration, &priority, &device, &track) < 6) {
+            printf("Error: line %d of %s is not a PCB\n", line, filename);
+            fclose(file);
+            return NULL;
+        }
         p = malloc(sizeof(node_t));
         pcb = new_pcb(pid, arrivalTime, totalCpuTime, ioFrequency, ioDuration, priority); // Create a new PCB structure with the extracted values
+        pcb->device = device;
+        pcb->track = track;
         p->pcb = pcb; // Assigns the PCB value to PCB structure created
         p->next = NULL; // Assigns the next value to NULL since it will be the last element in the queue
         enqueue(queue, p); // Enqueue the node containing the PCB into the queue
@@ -204,6 +744,28 @@ queue_t *read_CSV_file(const char filename[]){
     return queue;
 }
 
+/**
+ * This function prints the column titles of the output file.
+ *
+ * @param file   The open output file.
+ */
+void print_header(FILE *file) {
+    fprintf(file, "%-5s %-4s %-10s %-10s\n", "Time", "PID", "Old State", "New State");
+}
+
+/**
+ * This function prints one state transition as a line of the output file.
+ *
+ * @param file       The open output file.
+ * @param time       The time at which the PCB switches states.
+ * @param pid        The process ID (PID).
+ * @param oldState   The old state of the PCB.
+ * @param newState   The new state of the PCB.
+ */
+void print_transition(FILE *file, int time, int pid, const char *oldState, const char *newState) {
+    fprintf(file, "%-5d %-4d %-10s %-10s\n", time, pid, oldState, newState);
+}
+
 /**
  * This function writes the provided information for a PCB to the output file.
  *
@@ -221,177 +783,1108 @@ void write_text_file(const char *filename, int time, int pid, const char *oldSta
         return;
     }
 
-    fprintf(file, "%-5d %-4d %-10s %-10s\n", time, pid, oldState, newState);
+    print_transition(file, time, pid, oldState, newState);
 
     fclose(file);
 }
 
 /**
- * This function simulates an OS kernel, processing PCB state transitions.
- * 
- * @param new_queue    A pointer to the queue containing PCBs to process.
- * @param filename     The name of the output file for logging state transitions.
- * 
- * @return a pointer to the terminated queue.
+ * This function writes the buffered trace records to the binary trace file and empties the buffer.
+ *
+ * @param trace   A pointer to the transition log.
  */
-queue_t *flow_process(queue_t *new_queue, const char *filename, const char *algorithm){
-    queue_t *ready_queue = alloc_queue();
-    queue_t *running_queue = alloc_queue();
-    queue_t *waiting_queue = alloc_queue();
-    queue_t *terminated_queue = alloc_queue();
-
-    node_t *current;             // A pointer to the current node in the loop
-    node_t *removed;             // A pointer to the node being removed
-    node_t* highest_priority;    // A pointer to the node with the highest priority PCB (if Priority scheduling is chosen)
-    int size = new_queue->size;  // The number of PCBs, which is the size of the new_queue
-    int clock = 0;               // The timer
-    
-    // The while loop won't stop until all PCBs are terminated.
-    while(terminated_queue->size < size){
-
-        // Check for PCBs in the new queue and transitions them to the ready state if their arrival time matches the current clock time
-        if(new_queue->size != 0){
-            current =  new_queue->front;
-            int new_size = new_queue->size;
-
-            for(int i = 0; i < new_size; i++) {
-                if (current->pcb->arrival_time == clock) {
-                    node_t *next = current->next;
-                    removed = dequeue(new_queue);
-                    enqueue(ready_queue, removed);
-                    write_text_file(filename, clock, removed->pcb->pid, "New", "Ready");
-                    current = next;
-                }
-
-                else{
-                    current = current->next;
-                }
-            }
-        }
-
-        // Check for PCBs in the waiting queue and transition them to the ready state if their waiting time matches their I/O duration
-        if(waiting_queue->size != 0){
-            current = waiting_queue->front;
-            int waiting_size = waiting_queue->size;
-
-            for(int i = 0; i < waiting_size; i++) {
-                
-                current->pcb->waiting_time++;
+void flush_trace(trace_t *trace) {
+    if (trace->count != 0) {
+        fwrite(trace->buffer, sizeof(trace_record_t), trace->count, trace->file);
+        trace->count = 0;
+    }
+}
 
-                if (current->pcb->io_duration == current->pcb->waiting_time) {
-                    current->pcb->waiting_time = 0;
-                    node_t *next = current->next;
-                    removed = dequeueNode(waiting_queue, current);
-                    enqueue(ready_queue, removed);
-                    removed->pcb->start_io_time = clock; // Save the current clock time when moving from waiting to ready
-                    removed->pcb->io_interrupt = true;   // Set a flag to indicate that there was a system call to an I/O service
-                    write_text_file(filename, clock, removed->pcb->pid, "Waiting", "Ready");
-                    current = next;
-                }
-               
-                else{
-                    current = current->next;
-                }
-            } 
-        } 
+/**
+ * This function opens the transition log and writes the header of the output file.
+ *
+ * @param trace      A pointer to the transition log to initialize.
+ * @param filename   The name of the output file.
+ * @param mode       How the transitions are logged.
+ * @param capacity   The number of records buffered before the binary trace is flushed to its file.
+ * @return           true if the output file could be created, false otherwise.
+ */
+bool open_trace(trace_t *trace, const char *filename, log_mode_t mode, int capacity) {
+    trace->mode = mode;
+    trace->filename = filename;
+    trace->file = NULL;
+    trace->buffer = NULL;
+    trace->count = 0;
+    trace->capacity = capacity;
 
-        // Checks the PCB in the running queue and transitions them to the terminated state if their remaining CPU time is 0 
-        if(running_queue->size != 0){
-            running_queue->front->pcb->running_time++;
-            running_queue->front->pcb->remaining_CPU_time--;
-            
-            if (running_queue->front->pcb->remaining_CPU_time == 0) {
-                running_queue->front->pcb->end_time = clock;
-                removed = dequeue(running_queue);
-                enqueue(terminated_queue, removed);
-                write_text_file(filename, clock, removed->pcb->pid, "Running", "Terminated");
-            }
-        
-            // Checks the PCB in the running queue and transitions them to the waiting queue if their I/O frequency matches the running time
-            else if(running_queue->front->pcb->running_time == running_queue->front->pcb->io_frequency){
-                removed = dequeue(running_queue);
-                enqueue(waiting_queue, removed);
-                write_text_file(filename, clock, removed->pcb->pid, "Running", "Waiting");      
-            }
+    if (mode == LOG_NONE) {
+        return true;
+    }
 
-            // If the algorithm is RoundRobin, the PCB will transition from the running queue to the ready queue when the running time equals the time quantum
-            else if(strcmp(algorithm, "RoundRobin") == 0){
-                removed = dequeue(running_queue);
-                enqueue(ready_queue, removed);
-                removed->pcb->start_timer_time = clock; // Save the current clock time when moving from running to ready
-                removed->pcb->timer_interrupt = true; // Set a flag to indicate a timer interrupt occurred
-                write_text_file(filename, clock, removed->pcb->pid, "Running", "Ready");      
-            }
+    if (mode == LOG_TEXT) {
+        FILE *file = fopen(filename, "w");
+        if (file == NULL) {
+            printf("Error opening file %s\n", filename);
+            return false;
         }
+        print_header(file);
+        fclose(file);
+        return true;
+    }
 
-        // Checks the ready queue for PCBs and transitions the first PCB (or the highest priority PCB if the algorithm is Priority) in the ready queue to the running state if the running state is available
-        if(ready_queue->size != 0){
-            if (running_queue->size == 0) {
-                highest_priority = ready_queue->front;
-                // If the algorithm is Priority, the highest priority PCB is transitioned to the running state if the running state is available
-                if(strcmp(algorithm, "Priority") == 0){
-                    current = ready_queue->front;
-                    int ready_size = ready_queue->size;
-                    for(int i = 0; i < ready_size; i++) {
-                        if(highest_priority->pcb->priority > current->pcb->priority){
-                            highest_priority = current;
-                        }
-                        current = current->next;
-                    }
-                }
-
-                // Check if the PCB has not started executing yet
-                if (highest_priority->pcb->start_time == -1) {
-                    highest_priority->pcb->start_time = clock; // Record the start time when the PCB begins execution
-                }
-
-                // Check if the PCB experienced an I/O interrupt
-                if (highest_priority->pcb->io_interrupt) {
-                    highest_priority->pcb->io_interrupt = false; // Reset the I/O interrupt flag
-                    highest_priority->pcb->end_io_time = clock; // Record the end time of the I/O interrupt
-                    highest_priority->pcb->ready_waiting_time += highest_priority->pcb->end_io_time - highest_priority->pcb->start_io_time; // Update the total waiting time in the ready state due to I/O interrupt
-                    highest_priority->pcb->running_time = 0; // Reset the running time counter to check for other I/O calls
-                }
-
-                // Check if the PCB experienced a timer interrupt
-                if (highest_priority->pcb->timer_interrupt) {
-                    highest_priority->pcb->timer_interrupt = false; // Reset the timer interrupt flag
-                    highest_priority->pcb->end_timer_time = clock; // Record the end time of the timer interrupt
-                    highest_priority->pcb->ready_waiting_time += highest_priority->pcb->end_timer_time - highest_priority->pcb->start_timer_time; // Update the total waiting time in the ready state due to timer interrupt
-                }
+    trace->file = fopen(filename, "wb");
+    if (trace->file == NULL) {
+        printf("Error opening file %s\n", filename);
+        return false;
+    }
 
-                removed = dequeueNode(ready_queue, highest_priority);
-                enqueue(running_queue, removed);
-                write_text_file(filename, clock, removed->pcb->pid, "Ready", "Running");
-            }
-        }
+    trace_header_t header = {TRACE_MAGIC, sizeof(trace_record_t)};
+    fwrite(&header, sizeof(header), 1, trace->file);
 
-        // Increments the timer after each loop
-        clock++; 
-    }
-    
-    return terminated_queue;
+    trace->buffer = malloc((size_t)capacity * sizeof(trace_record_t));
+    assert(trace->buffer != NULL);
+    return true;
 }
 
 /**
- * Calculates the average turnaround time for processes in the queue.
+ * This function flushes any buffered records and closes the transition log.
  *
- * @param queue     Pointer to the queue containing PCBs.
- * @return          The average turnaround time of the processes in the queue.
+ * @param trace   A pointer to the transition log.
  */
-float average_turnaround_time(queue_t *queue){
-    float sum = 0;
-    for (node_t *current = queue->front; current != NULL; current = current->next) {
-        sum += (current->pcb->end_time - current->pcb->arrival_time);
+void close_trace(trace_t *trace) {
+    if (trace->mode == LOG_BINARY) {
+        flush_trace(trace);
+        fclose(trace->file);
+        free(trace->buffer);
+        trace->file = NULL;
+        trace->buffer = NULL;
     }
-    float turnaround = sum / (queue->size);
-    return turnaround;
 }
 
 /**
- * Calculates the average waiting time for processes in the queue.
+ * This function logs a state transition of a PCB, either as a line of text or as a binary trace record.
  *
- * @param queue     Pointer to the queue containing PCBs.
+ * @param trace      A pointer to the transition log.
+ * @param time       The time at which the PCB switches states.
+ * @param pid        The process ID (PID).
+ * @param oldState   The old state of the PCB.
+ * @param newState   The new state of the PCB.
+ */
+void log_transition(trace_t *trace, int time, int pid, state_t oldState, state_t newState) {
+    if (trace->mode == LOG_NONE) {
+        return;
+    }
+
+    if (trace->mode == LOG_TEXT) {
+        write_text_file(trace->filename, time, pid, state_names[oldState], state_names[newState]);
+        return;
+    }
+
+    trace_record_t *record = &trace->buffer[trace->count++];
+    record->time = time;
+    record->pid = pid;
+    record->old_state = oldState;
+    record->new_state = newState;
+    record->partition = -1;
+    record->memory = 0;
+
+    if (trace->count == trace->capacity) {
+        flush_trace(trace);
+    }
+}
+
+/**
+ * This function converts a binary trace file into the text output layout.
+ *
+ * @param trace_filename    The name of the binary trace file.
+ * @param output_filename   The name of the text output file.
+ * @return                  true if the trace was rendered, false if it could not be read or a record is corrupted.
+ */
+bool render_trace(const char *trace_filename, const char *output_filename) {
+    FILE *input = fopen(trace_filename, "rb");
+    if (input == NULL) {
+        printf("Error opening file %s\n", trace_filename);
+        return false;
+    }
+
+    trace_header_t header;
+    if (fread(&header, sizeof(header), 1, input) != 1 ||
+        memcmp(header.magic, TRACE_MAGIC, sizeof(header.magic)) != 0 ||
+        header.record_size != sizeof(trace_record_t)) {
+        printf("%s is not a Scheduler binary trace.\n", trace_filename);
+        fclose(input);
+        return false;
+    }
+
+    // A truncated trace ends with part of a record
+    long header_end = ftell(input);
+    fseek(input, 0, SEEK_END);
+    long trace_size = ftell(input) - header_end;
+    fseek(input, header_end, SEEK_SET);
+    if (trace_size % (long)sizeof(trace_record_t) != 0) {
+        printf("%s is truncated.\n", trace_filename);
+        fclose(input);
+        return false;
+    }
+
+    FILE *output = fopen(output_filename, "w");
+    if (output == NULL) {
+        printf("Error opening file %s\n", output_filename);
+        fclose(input);
+        return false;
+    }
+
+    print_header(output);
+
+    trace_record_t records[TRACE_BUFFER_RECORDS];
+    size_t count;
+    long record_number = 0;
+    bool valid = true;
+    while (valid && (count = fread(records, sizeof(trace_record_t), TRACE_BUFFER_RECORDS, input)) > 0) {
+        for (size_t i = 0; i < count; i++) {
+            record_number++;
+            if (records[i].old_state > STATE_TERMINATED || records[i].new_state > STATE_TERMINATED) {
+                printf("Record %ld of %s is corrupted.\n", record_number, trace_filename);
+                valid = false;
+                break;
+            }
+            print_transition(output, records[i].time, records[i].pid, state_names[records[i].old_state], state_names[records[i].new_state]);
+        }
+    }
+
+    fclose(output);
+    fclose(input);
+    return valid;
+}
+
+/**
+ * This function allocates a simulation on the heap with all PCBs in the new queue and the timer at 0.
+ *
+ * @param new_queue      A pointer to the queue containing PCBs to process.
+ * @param device_count   The number of I/O devices, or 0 if every waiting PCB does its I/O in parallel.
+ * @return               A pointer to the simulation created.
+ */
+simulation_t *new_simulation(queue_t *new_queue, int device_count) {
+    simulation_t *sim = malloc(sizeof(simulation_t));
+    assert(sim != NULL);
+    sim->new_queue = new_queue;
+    sim->ready_queue = alloc_queue();
+    sim->running_queue = alloc_queue();
+    sim->waiting_queue = alloc_queue();
+    sim->terminated_queue = alloc_queue();
+    for (int i = 0; i < MLFQ_LEVELS; i++) {
+        sim->levels[i] = alloc_queue();
+    }
+    sim->level_bitmap = 0;
+    sim->size = new_queue->size;
+    sim->clock = 0;
+    sim->switch_time = 0;
+    sim->pending_transitions = 0;
+    sim->device_count = device_count;
+    for (int i = 0; i < device_count; i++) {
+        device_t *device = &sim->devices[i];
+        device->queue = alloc_queue();
+        device->head = 0;
+        device->direction = 1;
+        device->busy_ticks = 0;
+        device->requests = 0;
+    }
+    return sim;
+}
+
+/**
+ * This function returns the number of PCBs in the ready state, whether they are in the ready queue or in the MLFQ levels.
+ *
+ * @param sim   A pointer to the simulation.
+ * @return      The number of ready PCBs.
+ */
+int ready_count(const simulation_t *sim) {
+    int count = sim->ready_queue->size;
+    for (int i = 0; i < MLFQ_LEVELS; i++) {
+        count += sim->levels[i]->size;
+    }
+    return count;
+}
+
+/**
+ * This function appends a PCB to the ready queue of its level in the multilevel feedback queue.
+ *
+ * @param sim    A pointer to the simulation.
+ * @param node   A pointer to the node of the PCB.
+ */
+void mlfq_enqueue(simulation_t *sim, node_t *node) {
+    int level = node->pcb->level;
+    enqueue(sim->levels[level], node);
+    sim->level_bitmap |= 1u << level;
+}
+
+/**
+ * This function removes the first PCB of the highest non-empty level of the multilevel feedback queue.
+ * The level is found with a single find-first-set on the bitmap of non-empty levels, so dispatching takes constant time.
+ *
+ * @param sim   A pointer to the simulation, with at least one ready PCB in the levels.
+ * @return      A pointer to the node of the removed PCB.
+ */
+node_t *mlfq_dequeue(simulation_t *sim) {
+    assert(sim->level_bitmap != 0);
+    int level = __builtin_ctz(sim->level_bitmap);
+    node_t *node = dequeue(sim->levels[level]);
+    if (sim->levels[level]->size == 0) {
+        sim->level_bitmap &= ~(1u << level);
+    }
+    node->next = NULL;
+    return node;
+}
+
+/**
+ * This function moves every PCB back to the highest level of the multilevel feedback queue, so PCBs in the lower levels cannot starve.
+ * The ready PCBs keep their order, the PCBs of higher levels stay ahead of those of lower levels.
+ *
+ * @param sim   A pointer to the simulation.
+ */
+void mlfq_boost(simulation_t *sim) {
+    queue_t *others[3 + MAX_DEVICES] = {sim->levels[0], sim->running_queue, sim->waiting_queue};
+    for (int i = 0; i < sim->device_count; i++) {
+        others[3 + i] = sim->devices[i].queue;
+    }
+    for (int i = 0; i < 3 + sim->device_count; i++) {
+        node_t *current = others[i]->front;
+        for (int j = 0; j < others[i]->size; j++) {
+            current->pcb->level = 0;
+            current->pcb->quantum_used = 0;
+            current = current->next;
+        }
+    }
+
+    for (int level = 1; level < MLFQ_LEVELS; level++) {
+        while (sim->levels[level]->size != 0) {
+            node_t *node = dequeue(sim->levels[level]);
+            node->pcb->level = 0;
+            node->pcb->quantum_used = 0;
+            enqueue(sim->levels[0], node);
+        }
+    }
+    sim->level_bitmap = (sim->levels[0]->size != 0) ? 1u : 0u;
+}
+
+/**
+ * This function returns the number of PCBs in the waiting state, including those in the queues of the I/O devices.
+ *
+ * @param sim   A pointer to the simulation.
+ * @return      The number of waiting PCBs.
+ */
+int waiting_count(const simulation_t *sim) {
+    int count = sim->waiting_queue->size;
+    for (int i = 0; i < sim->device_count; i++) {
+        count += sim->devices[i].queue->size;
+    }
+    return count;
+}
+
+/**
+ * This function starts serving the next request of an I/O device and moves it to the front of the device queue.
+ * The service time is the I/O duration of the PCB plus the time the head takes to move to the track of the request.
+ *
+ * @param device      A pointer to the device, whose queue must not be empty.
+ * @param policy      The order in which the device serves its requests.
+ * @param seek_time   The time the head takes to move by one track.
+ */
+void start_io(device_t *device, io_policy_t policy, int seek_time) {
+    queue_t *queue = device->queue;
+    node_t *next = queue->front;
+
+    // The elevator serves the nearest request in the direction the head moves and reverses when there is none left in that direction
+    if (policy == IO_ELEVATOR) {
+        for (int pass = 0; pass < 2; pass++) {
+            node_t *best = NULL;
+            node_t *current = queue->front;
+            for (int i = 0; i < queue->size; i++) {
+                int distance = (current->pcb->track - device->head) * device->direction;
+                if (distance >= 0 && (best == NULL || distance < (best->pcb->track - device->head) * device->direction)) {
+                    best = current;
+                }
+                current = current->next;
+            }
+            if (best != NULL) {
+                next = best;
+                break;
+            }
+            device->direction = -device->direction;
+        }
+
+        if (next != queue->front) {
+            dequeueNode(queue, next);
+            next->next = queue->front;
+            queue->front = next;
+            queue->size++;
+        }
+    }
+
+    int distance = abs(next->pcb->track - device->head);
+    next->pcb->io_service = next->pcb->io_duration + seek_time * distance;
+    if (next->pcb->io_service < 1) {
+        next->pcb->io_service = 1;
+    }
+    next->pcb->waiting_time = 0;
+    device->head = next->pcb->track;
+}
+
+/**
+ * This function queues the I/O request of a PCB at its device, the device starts serving it at once if it is idle.
+ *
+ * @param sim         A pointer to the simulation.
+ * @param node        A pointer to the node of the PCB that moved to the waiting state.
+ * @param policy      The order in which the device serves its requests.
+ * @param seek_time   The time the head takes to move by one track.
+ */
+void submit_io(simulation_t *sim, node_t *node, io_policy_t policy, int seek_time) {
+    device_t *device = &sim->devices[node->pcb->device];
+    enqueue(device->queue, node);
+    if (device->queue->size == 1) {
+        start_io(device, policy, seek_time);
+    }
+}
+
+/**
+ * This function saves the state of a simulation to a checkpoint file.
+ * The file is written under a temporary name first so a crash while saving never destroys the previous checkpoint.
+ *
+ * @param sim        A pointer to the simulation to save.
+ * @param filename   The name of the checkpoint file.
+ * @return           true if the checkpoint was saved, false otherwise.
+ */
+bool save_checkpoint(const simulation_t *sim, const char *filename) {
+    // The MLFQ levels are saved after the ready queue as part of the ready section, in the order they are dispatched,
+    // and the queues of the I/O devices after the waiting queue as part of the waiting section
+    queue_t *queues[5 + MLFQ_LEVELS + MAX_DEVICES];
+    int sections[5 + MLFQ_LEVELS + MAX_DEVICES];
+    int count = 0;
+    queues[count] = sim->new_queue;
+    sections[count++] = 0;
+    queues[count] = sim->ready_queue;
+    sections[count++] = 1;
+    for (int level = 0; level < MLFQ_LEVELS; level++) {
+        queues[count] = sim->levels[level];
+        sections[count++] = 1;
+    }
+    queues[count] = sim->running_queue;
+    sections[count++] = 2;
+    queues[count] = sim->waiting_queue;
+    sections[count++] = 3;
+    for (int i = 0; i < sim->device_count; i++) {
+        queues[count] = sim->devices[i].queue;
+        sections[count++] = 3;
+    }
+    queues[count] = sim->terminated_queue;
+    sections[count++] = 4;
+
+    char temp_filename[1024];
+    snprintf(temp_filename, sizeof(temp_filename), "%s.tmp", filename);
+
+    FILE *file = fopen(temp_filename, "wb");
+    if (file == NULL) {
+        printf("Error opening file %s\n", temp_filename);
+        return false;
+    }
+
+    checkpoint_header_t header = {CHECKPOINT_MAGIC, sizeof(pcb_t), sim->clock, sim->switch_time, sim->pending_transitions, sim->device_count, {0}};
+    for (int i = 0; i < count; i++) {
+        header.queue_sizes[sections[i]] += queues[i]->size;
+    }
+    fwrite(&header, sizeof(header), 1, file);
+
+    // The PCBs of each queue are saved in queue order, counting by size since dequeued nodes keep their old next pointer
+    for (int i = 0; i < count; i++) {
+        node_t *current = queues[i]->front;
+        for (int j = 0; j < queues[i]->size; j++) {
+            fwrite(current->pcb, sizeof(pcb_t), 1, file);
+            current = current->next;
+        }
+    }
+
+    // The PCBs in the device queues keep their device and service progress, only the heads and the counters are saved separately
+    for (int i = 0; i < sim->device_count; i++) {
+        const device_t *device = &sim->devices[i];
+        int32_t state[4] = {device->head, device->direction, device->busy_ticks, device->requests};
+        fwrite(state, sizeof(state), 1, file);
+    }
+
+    bool saved = (fclose(file) == 0);
+    if (!saved) {
+        printf("Error writing file %s\n", temp_filename);
+        return false;
+    }
+
+    remove(filename);
+    if (rename(temp_filename, filename) != 0) {
+        printf("Error renaming %s to %s\n", temp_filename, filename);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * This function restores a simulation from a checkpoint file.
+ *
+ * @param filename   The name of the checkpoint file.
+ * @return           A pointer to the restored simulation, or NULL if the file could not be read.
+ */
+simulation_t *load_checkpoint(const char *filename) {
+    FILE *file = fopen(filename, "rb");
+    if (file == NULL) {
+        printf("Error opening file %s\n", filename);
+        return NULL;
+    }
+
+    checkpoint_header_t header;
+    if (fread(&header, sizeof(header), 1, file) != 1 ||
+        memcmp(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic)) != 0 ||
+        header.pcb_size != sizeof(pcb_t) ||
+        header.device_count < 0 || header.device_count > MAX_DEVICES) {
+        printf("%s is not a Scheduler checkpoint.\n", filename);
+        fclose(file);
+        return NULL;
+    }
+
+    simulation_t *sim = new_simulation(alloc_queue(), header.device_count);
+    queue_t *queues[5] = {sim->new_queue, sim->ready_queue, sim->running_queue, sim->waiting_queue, sim->terminated_queue};
+    sim->clock = header.clock;
+    sim->switch_time = header.switch_time;
+    sim->pending_transitions = header.pending_transitions;
+    sim->size = 0;
+
+    for (int i = 0; i < 5; i++) {
+        for (int j = 0; j < header.queue_sizes[i]; j++) {
+            pcb_t *pcb = malloc(sizeof(pcb_t));
+            assert(pcb != NULL);
+            if (fread(pcb, sizeof(pcb_t), 1, file) != 1) {
+                printf("%s is truncated.\n", filename);
+                free(pcb);
+                fclose(file);
+                return NULL;
+            }
+            node_t *p = malloc(sizeof(node_t));
+            assert(p != NULL);
+            p->pcb = pcb;
+            p->next = NULL;
+            enqueue(queues[i], p);
+            sim->size++;
+        }
+    }
+
+    // The waiting PCBs stay in the waiting queue until flow_process moves them back into the queues of their devices
+    for (int i = 0; i < sim->device_count; i++) {
+        device_t *device = &sim->devices[i];
+        int32_t state[4];
+        if (fread(state, sizeof(state), 1, file) != 1) {
+            printf("%s is truncated.\n", filename);
+            fclose(file);
+            return NULL;
+        }
+        device->head = state[0];
+        device->direction = state[1];
+        device->busy_ticks = state[2];
+        device->requests = state[3];
+    }
+
+    fclose(file);
+    return sim;
+}
+
+/**
+ * This function opens the telemetry file and writes its column titles.
+ *
+ * @param telemetry   A pointer to the telemetry sampler to initialize.
+ * @param filename    The name of the telemetry file.
+ * @param interval    A sample is recorded every interval ticks, or whenever a gauge changes if 0.
+ * @param cpus        The number of CPUs.
+ * @param buffer      The size in bytes of the file buffer, or 0 for the default.
+ * @return            true if the telemetry file could be created, false otherwise.
+ */
+bool open_telemetry(telemetry_t *telemetry, const char *filename, int interval, int cpus, int buffer) {
+    telemetry->interval = interval;
+    telemetry->cpus = cpus;
+    telemetry->busy_ticks = 0;
+    telemetry->ticks = 0;
+    telemetry->last_ready = -1;
+    telemetry->last_waiting = -1;
+    telemetry->last_running = -1;
+    telemetry->file = fopen(filename, "w");
+    if (telemetry->file == NULL) {
+        printf("Error opening file %s\n", filename);
+        return false;
+    }
+    if (buffer > 0) {
+        setvbuf(telemetry->file, NULL, _IOFBF, buffer);
+    }
+    fprintf(telemetry->file, "time,ready_queue,waiting_queue,running_queue,cpu_busy_fraction\n");
+    return true;
+}
+
+/**
+ * This function records the gauges at the end of a tick if a sample is due.
+ * The queue sizes are read from the size fields of the queues and only the running PCBs are visited, so each tick costs O(cpus)
+ * whether or not a sample is written.
+ *
+ * @param telemetry   A pointer to the telemetry sampler.
+ * @param clock       The current time.
+ * @param sim         A pointer to the simulation being sampled.
+ * @param last        true if the simulation ends or pauses after this tick, so the ticks since the last sample are written even if the interval is not over.
+ */
+void sample_telemetry(telemetry_t *telemetry, int clock, const simulation_t *sim, bool last) {
+    int ready = ready_count(sim);
+    int waiting = waiting_count(sim);
+    int running = sim->running_queue->size;
+
+    // A CPU is busy until the next tick if a PCB was dispatched to it or kept running on it, a CPU still switching to its PCB is idle
+    telemetry->ticks++;
+    node_t *current = sim->running_queue->front;
+    for (int i = 0; i < running; i++) {
+        if (current->pcb->switch_remaining == 0) {
+            telemetry->busy_ticks++;
+        }
+        current = current->next;
+    }
+
+    bool record;
+    if (telemetry->interval > 0) {
+        record = (clock % telemetry->interval == 0 || last);
+    }
+    else {
+        record = (ready != telemetry->last_ready || waiting != telemetry->last_waiting || running != telemetry->last_running);
+    }
+
+    if (record) {
+        fprintf(telemetry->file, "%d,%d,%d,%d,%.3f\n", clock, ready, waiting, running, (float)telemetry->busy_ticks / ((float)telemetry->ticks * telemetry->cpus));
+        telemetry->busy_ticks = 0;
+        telemetry->ticks = 0;
+        telemetry->last_ready = ready;
+        telemetry->last_waiting = waiting;
+        telemetry->last_running = running;
+    }
+}
+
+/**
+ * This function closes the telemetry file.
+ *
+ * @param telemetry   A pointer to the telemetry sampler.
+ */
+void close_telemetry(telemetry_t *telemetry) {
+    if (telemetry->file != NULL) {
+        fclose(telemetry->file);
+        telemetry->file = NULL;
+    }
+}
+
+/**
+ * This function moves a PCB into the ready state, appending it to the ready queue or to the queue of its MLFQ level.
+ * In the dense tick mode the dense copy holds the ready PCBs in order, only the size of the linked ready queue is kept up to date
+ * and its links are rebuilt when a checkpoint is saved.
+ *
+ * @param sim           A pointer to the simulation.
+ * @param dense_ready   A pointer to the dense copy of the ready queue, or NULL if there is none.
+ * @param node          A pointer to the node of the PCB.
+ * @param mlfq          true if the algorithm is MLFQ.
+ */
+void enqueue_ready(simulation_t *sim, dense_queue_t *dense_ready, node_t *node, bool mlfq) {
+    if (mlfq) {
+        mlfq_enqueue(sim, node);
+        return;
+    }
+    if (dense_ready != NULL) {
+        dense_push(dense_ready, node, node->pcb->priority, 0);
+        sim->ready_queue->size++;
+        return;
+    }
+    enqueue(sim->ready_queue, node);
+}
+
+/**
+ * This function counts a state transition for the kernel overhead and logs it unless the simulation runs in the metrics-only mode.
+ * It is inlined with a constant logging flag, so in the metrics-only instantiation the logging call disappears entirely.
+ *
+ * @param logging       true to log the transition.
+ * @param trace         A pointer to the transition log.
+ * @param transitions   A pointer to the number of transitions since the last dispatch.
+ * @param time       The time at which the PCB switches states.
+ * @param pid        The process ID.
+ * @param oldState   The old state of the PCB.
+ * @param newState   The new state of the PCB.
+ */
+static ALWAYS_INLINE void trace_transition(const bool logging, trace_t *trace, int *transitions, int time, int pid, state_t oldState, state_t newState) {
+    (*transitions)++;
+    if (logging) {
+        log_transition(trace, time, pid, oldState, newState);
+    }
+}
+
+/**
+ * This function simulates an OS kernel, processing PCB state transitions.
+ * 
+ * The simulation continues from the state in sim, which is either a new simulation or one restored from a checkpoint.
+ * 
+ * @param sim          A pointer to the simulation to run.
+ * @param trace        A pointer to the transition log.
+ * @param config       A pointer to the settings of the run (algorithm, quantum, CPUs, checkpoints and tick mode).
+ * @param telemetry    A pointer to the telemetry sampler, or NULL to run without telemetry.
+ * @param logging      true to log every transition, false to only update the PCB fields the metrics are calculated from.
+ *                     Every caller passes a constant, so the logging calls are compiled out of the metrics-only instantiation.
+ * 
+ * @return a pointer to the terminated queue, or NULL if the simulation was paused.
+ */
+static ALWAYS_INLINE queue_t *simulate(simulation_t *sim, trace_t *trace, const config_t *config, telemetry_t *telemetry, const bool logging){
+    queue_t *new_queue = sim->new_queue;
+    queue_t *ready_queue = sim->ready_queue;
+    queue_t *running_queue = sim->running_queue;
+    queue_t *waiting_queue = sim->waiting_queue;
+    queue_t *terminated_queue = sim->terminated_queue;
+
+    node_t *current;             // A pointer to the current node in the loop
+    node_t *removed;             // A pointer to the node being removed
+    node_t* highest_priority;    // A pointer to the node with the highest priority PCB (if Priority scheduling is chosen)
+    int size = sim->size;        // The number of PCBs in the simulation
+    int clock = sim->clock;      // The timer
+    int start_clock = clock;     // The time the simulation started or resumed at
+    bool round_robin = (config->algorithm == ALG_ROUND_ROBIN);
+    bool priority = (config->algorithm == ALG_PRIORITY);
+    bool mlfq = (config->algorithm == ALG_MLFQ);
+    bool dense_tick = config->dense_tick;
+    const checkpoint_t *checkpoint = &config->checkpoint;
+    int quantum = (config->quantum > 0) ? config->quantum : (mlfq ? MLFQ_BASE_QUANTUM : 1); // The time quantum of RoundRobin or of the highest MLFQ level
+    int switch_time = sim->switch_time;          // The CPU time spent on context switches and kernel overhead
+    int transitions = sim->pending_transitions;  // The transitions since the last dispatch
+
+    // A simulation resumed with fewer CPUs than it was saved with preempts the PCBs dispatched last until every PCB has a CPU
+    while (running_queue->size > config->cpus) {
+        current = running_queue->front;
+        for (int i = 0; i < config->cpus; i++) {
+            current = current->next;
+        }
+        removed = dequeueNode(running_queue, current);
+        enqueue(ready_queue, removed);
+        removed->pcb->start_timer_time = clock; // Save the current clock time when moving from running to ready
+        removed->pcb->timer_interrupt = true; // Set a flag to indicate a timer interrupt occurred
+        trace_transition(logging, trace, &transitions, clock, removed->pcb->pid, STATE_RUNNING, STATE_READY);
+    }
+
+    // With MLFQ scheduling the ready PCBs wait in the queue of their level, including those restored from a checkpoint
+    if (mlfq) {
+        while (ready_queue->size != 0) {
+            mlfq_enqueue(sim, dequeue(ready_queue));
+        }
+    }
+
+    // With I/O devices the waiting PCBs restored from a checkpoint go back to the queues of their devices in the saved order,
+    // so the PCB at the front of each queue continues the request it was being served
+    bool devices = (sim->device_count > 0);
+    while (devices && waiting_queue->size != 0) {
+        removed = dequeue(waiting_queue);
+        enqueue(sim->devices[removed->pcb->device].queue, removed);
+    }
+
+    // In the dense tick mode the waiting times live in dense_waiting and the priorities of the ready PCBs in dense_ready
+    tick_kernels_t kernels = select_tick_kernels();
+    dense_queue_t *dense_waiting = NULL;
+    dense_queue_t *dense_ready = NULL;
+    if (dense_tick) {
+        dense_waiting = alloc_dense_queue(size);
+        current = waiting_queue->front;
+        for (int i = 0; i < waiting_queue->size; i++) {
+            dense_push(dense_waiting, current, current->pcb->waiting_time, current->pcb->io_duration);
+            current = current->next;
+        }
+    }
+    // The MLFQ levels already give constant-time dispatch, so the ready queue is only made dense for the other algorithms.
+    // Twice the number of PCBs leaves room for as many dispatches as there are PCBs between two compactions of the array
+    if (dense_tick && !mlfq) {
+        dense_ready = alloc_dense_queue(2 * size);
+        current = ready_queue->front;
+        for (int i = 0; i < ready_queue->size; i++) {
+            dense_push(dense_ready, current, current->pcb->priority, 0);
+            current = current->next;
+        }
+    }
+
+    
+    // The while loop won't stop until all PCBs are terminated.
+    while(terminated_queue->size < size){
+
+        // Save the state at the start of the tick if a checkpoint is due, and pause the simulation if the stop time is reached
+        if (checkpoint->filename != NULL) {
+            bool stop = (clock == checkpoint->stop_time);
+            bool due = (checkpoint->interval > 0 && clock != start_clock && clock % checkpoint->interval == 0);
+            if (checkpoint->filename != NULL && (stop || due)) {
+                sim->clock = clock;
+                sim->switch_time = switch_time;
+                sim->pending_transitions = transitions;
+                if (logging && trace->mode == LOG_BINARY) {
+                    flush_trace(trace); // Keep the trace on disk consistent with the checkpoint
+                }
+                for (int i = 0; dense_tick && i < dense_waiting->size; i++) {
+                    dense_waiting->nodes[i]->pcb->waiting_time = dense_waiting->values[i];
+                }
+                if (dense_ready != NULL) {
+                    relink_queue(ready_queue, dense_ready);
+                }
+                save_checkpoint(sim, checkpoint->filename);
+            }
+            if (stop) {
+                if (dense_tick) {
+                    free_dense_queue(dense_waiting);
+                }
+                if (dense_ready != NULL) {
+                    free_dense_queue(dense_ready);
+                }
+                return NULL;
+            }
+        }
+
+        // With MLFQ scheduling all PCBs are periodically moved back to the highest level so none of them starves
+        if (mlfq && clock != 0 && clock % MLFQ_BOOST_INTERVAL == 0) {
+            mlfq_boost(sim);
+        }
+
+        // Check for PCBs in the new queue and transitions them to the ready state if their arrival time matches the current clock time
+        if(new_queue->size != 0){
+            current =  new_queue->front;
+            int new_size = new_queue->size;
+
+            for(int i = 0; i < new_size; i++) {
+                if (current->pcb->arrival_time == clock) {
+                    node_t *next = current->next;
+                    removed = dequeue(new_queue);
+                    enqueue_ready(sim, dense_ready, removed, mlfq);
+                    trace_transition(logging, trace, &transitions, clock, removed->pcb->pid, STATE_NEW, STATE_READY);
+                    current = next;
+                }
+
+                else{
+                    current = current->next;
+                }
+            }
+        }
+
+        // With I/O devices only the request at the front of each device queue makes progress, the other PCBs wait for the device.
+        // When a request is complete the device starts serving its next request, which makes progress from the next tick
+        if(devices){
+            for (int d = 0; d < sim->device_count; d++) {
+                device_t *device = &sim->devices[d];
+                if (device->queue->size == 0) {
+                    continue;
+                }
+                device->busy_ticks++;
+                current = device->queue->front;
+                current->pcb->waiting_time++;
+
+                if (current->pcb->waiting_time == current->pcb->io_service) {
+                    current->pcb->waiting_time = 0;
+                    removed = dequeue(device->queue);
+                    device->requests++;
+                    enqueue_ready(sim, dense_ready, removed, mlfq);
+                    removed->pcb->start_io_time = clock; // Save the current clock time when moving from waiting to ready
+                    removed->pcb->io_interrupt = true;   // Set a flag to indicate that there was a system call to an I/O service
+                    trace_transition(logging, trace, &transitions, clock, removed->pcb->pid, STATE_WAITING, STATE_READY);
+                    if (device->queue->size != 0) {
+                        start_io(device, config->io_policy, config->seek_time);
+                    }
+                }
+            }
+        }
+
+        // In the dense tick mode all waiting times are incremented and compared with the I/O durations by one kernel call,
+        // then the PCBs whose bits are set move to the ready state in queue order
+        else if(dense_tick && dense_waiting->size != 0){
+            int waiting_size = dense_waiting->size;
+            kernels.tick_waiting(dense_waiting->values, dense_waiting->limits, waiting_size, dense_waiting->mask);
+
+            // Skip the words of the mask without completions, most ticks have none
+            int first = waiting_size;
+            for (int w = 0; w <= (waiting_size - 1) / 32; w++) {
+                if (dense_waiting->mask[w] != 0) {
+                    first = w * 32 + __builtin_ctz(dense_waiting->mask[w]);
+                    break;
+                }
+            }
+
+            if (first < waiting_size) {
+                int kept = first;
+                for (int i = first; i < waiting_size; i++) {
+                    if (dense_waiting->mask[i / 32] & (1u << (i % 32))) {
+                        removed = dense_waiting->nodes[i];
+                        removed->pcb->waiting_time = 0;
+                        enqueue_ready(sim, dense_ready, removed, mlfq);
+                        removed->pcb->start_io_time = clock; // Save the current clock time when moving from waiting to ready
+                        removed->pcb->io_interrupt = true;   // Set a flag to indicate that there was a system call to an I/O service
+                        trace_transition(logging, trace, &transitions, clock, removed->pcb->pid, STATE_WAITING, STATE_READY);
+                    }
+                    else {
+                        dense_waiting->nodes[kept] = dense_waiting->nodes[i];
+                        dense_waiting->values[kept] = dense_waiting->values[i];
+                        dense_waiting->limits[kept] = dense_waiting->limits[i];
+                        kept++;
+                    }
+                }
+                dense_waiting->size = kept;
+                relink_queue(waiting_queue, dense_waiting);
+            }
+        }
+
+        // Check for PCBs in the waiting queue and transition them to the ready state if their waiting time matches their I/O duration
+        else if(waiting_queue->size != 0){
+            current = waiting_queue->front;
+            int waiting_size = waiting_queue->size;
+
+            for(int i = 0; i < waiting_size; i++) {
+                
+                current->pcb->waiting_time++;
+
+                if (current->pcb->io_duration == current->pcb->waiting_time) {
+                    current->pcb->waiting_time = 0;
+                    node_t *next = current->next;
+                    removed = dequeueNode(waiting_queue, current);
+                    enqueue_ready(sim, dense_ready, removed, mlfq);
+                    removed->pcb->start_io_time = clock; // Save the current clock time when moving from waiting to ready
+                    removed->pcb->io_interrupt = true;   // Set a flag to indicate that there was a system call to an I/O service
+                    trace_transition(logging, trace, &transitions, clock, removed->pcb->pid, STATE_WAITING, STATE_READY);
+                    current = next;
+                }
+               
+                else{
+                    current = current->next;
+                }
+            } 
+        } 
+
+        // Checks the PCBs in the running queue (one per busy CPU) and transitions them to the terminated state if their remaining CPU time is 0 
+        if(running_queue->size != 0){
+            current = running_queue->front;
+            int running_size = running_queue->size;
+
+            for(int i = 0; i < running_size; i++) {
+                node_t *next = current->next;
+
+                // The CPU switches to the PCB before running it, the switch time is charged to the CPU as idle time
+                if (current->pcb->switch_remaining > 0) {
+                    current->pcb->switch_remaining--;
+                    switch_time++;
+                    current = next;
+                    continue;
+                }
+
+                current->pcb->running_time++;
+                current->pcb->remaining_CPU_time--;
+                current->pcb->quantum_used++; // For MLFQ the quantum is not reset by I/O, so a PCB cannot keep its level by yielding just before it expires
+
+                if (current->pcb->remaining_CPU_time == 0) {
+                    current->pcb->end_time = clock;
+                    removed = dequeueNode(running_queue, current);
+                    enqueue(terminated_queue, removed);
+                    trace_transition(logging, trace, &transitions, clock, removed->pcb->pid, STATE_RUNNING, STATE_TERMINATED);
+                }
+            
+                // Checks the PCB in the running queue and transitions them to the waiting queue if their I/O frequency matches the running time
+                else if(current->pcb->running_time == current->pcb->io_frequency){
+                    removed = dequeueNode(running_queue, current);
+
+                    // With MLFQ a PCB whose quantum runs out on the tick of its I/O call is demoted as well, so it cannot keep its level by doing I/O
+                    if (mlfq && removed->pcb->quantum_used >= (quantum << removed->pcb->level)) {
+                        if (removed->pcb->level < MLFQ_LEVELS - 1) {
+                            removed->pcb->level++;
+                        }
+                        removed->pcb->quantum_used = 0;
+                    }
+                    if (devices) {
+                        submit_io(sim, removed, config->io_policy, config->seek_time);
+                    }
+                    else {
+                        enqueue(waiting_queue, removed);
+                    }
+                    if (dense_tick) {
+                        dense_push(dense_waiting, removed, removed->pcb->waiting_time, removed->pcb->io_duration);
+                    }
+                    trace_transition(logging, trace, &transitions, clock, removed->pcb->pid, STATE_RUNNING, STATE_WAITING);      
+                }
+
+                // If the algorithm is RoundRobin, the PCB will transition from the running queue to the ready queue when the running time reaches the time quantum.
+                // A PCB resumed from a checkpoint saved with a longer quantum may already be past it
+                else if(round_robin && current->pcb->quantum_used >= quantum){
+                    removed = dequeueNode(running_queue, current);
+                    enqueue_ready(sim, dense_ready, removed, mlfq);
+                    removed->pcb->start_timer_time = clock; // Save the current clock time when moving from running to ready
+                    removed->pcb->timer_interrupt = true; // Set a flag to indicate a timer interrupt occurred
+                    trace_transition(logging, trace, &transitions, clock, removed->pcb->pid, STATE_RUNNING, STATE_READY);      
+                }
+
+                // If the algorithm is MLFQ, the PCB is demoted to the next level and transitions to the ready state when it used up the quantum of its level
+                else if(mlfq && current->pcb->quantum_used >= (quantum << current->pcb->level)){
+                    removed = dequeueNode(running_queue, current);
+                    if (removed->pcb->level < MLFQ_LEVELS - 1) {
+                        removed->pcb->level++;
+                    }
+                    removed->pcb->quantum_used = 0;
+                    enqueue_ready(sim, dense_ready, removed, mlfq);
+                    removed->pcb->start_timer_time = clock; // Save the current clock time when moving from running to ready
+                    removed->pcb->timer_interrupt = true; // Set a flag to indicate a timer interrupt occurred
+                    trace_transition(logging, trace, &transitions, clock, removed->pcb->pid, STATE_RUNNING, STATE_READY);
+                }
+
+                current = next;
+            }
+        }
+
+        // Checks the ready queue for PCBs and transitions the first PCB (or the highest priority PCB if the algorithm is Priority) in the ready queue to the running state while a CPU is available
+        while(mlfq ? sim->level_bitmap != 0 : ready_queue->size != 0){
+            if (running_queue->size >= config->cpus) {
+                break;
+            }
+            else {
+                highest_priority = ready_queue->front;
+
+                // If the algorithm is MLFQ, the first PCB of the highest non-empty level is taken from its level queue
+                if(mlfq){
+                    highest_priority = mlfq_dequeue(sim);
+                }
+
+                // In the dense tick mode the highest priority PCB is found by the argmin kernel over the dense priorities and taken out of the array in O(1)
+                else if(dense_tick){
+                    int head = dense_ready->head;
+                    int index = head + (priority ? kernels.argmin(dense_ready->values + head, dense_ready->size - head) : 0);
+                    highest_priority = dense_take(dense_ready, index);
+                    ready_queue->size--;
+                }
+
+                // If the algorithm is Priority, the highest priority PCB is transitioned to the running state if the running state is available
+                else if(priority){
+                    current = ready_queue->front;
+                    int ready_size = ready_queue->size;
+                    for(int i = 0; i < ready_size; i++) {
+                        if(highest_priority->pcb->priority > current->pcb->priority){
+                            highest_priority = current;
+                        }
+                        current = current->next;
+                    }
+                }
+
+                // A RoundRobin time slice starts whenever the PCB is dispatched
+                if (round_robin) {
+                    highest_priority->pcb->quantum_used = 0;
+                }
+
+                // Check if the PCB has not started executing yet
+                if (highest_priority->pcb->start_time == -1) {
+                    highest_priority->pcb->start_time = clock; // Record the start time when the PCB begins execution
+                }
+
+                // Check if the PCB experienced an I/O interrupt
+                if (highest_priority->pcb->io_interrupt) {
+                    highest_priority->pcb->io_interrupt = false; // Reset the I/O interrupt flag
+                    highest_priority->pcb->end_io_time = clock; // Record the end time of the I/O interrupt
+                    highest_priority->pcb->ready_waiting_time += highest_priority->pcb->end_io_time - highest_priority->pcb->start_io_time; // Update the total waiting time in the ready state due to I/O interrupt
+                    highest_priority->pcb->running_time = 0; // Reset the running time counter to check for other I/O calls
+                }
+
+                // The dispatch costs a context switch, unless the PCB was preempted on this tick and continues without another PCB running in between,
+                // plus the kernel overhead of the transitions handled since the previous dispatch
+                bool resumed = (highest_priority->pcb->timer_interrupt && highest_priority->pcb->start_timer_time == clock);
+                highest_priority->pcb->switch_remaining = (resumed ? 0 : config->switch_cost) + config->transition_overhead * transitions;
+                transitions = 0;
+
+                // Check if the PCB experienced a timer interrupt
+                if (highest_priority->pcb->timer_interrupt) {
+                    highest_priority->pcb->timer_interrupt = false; // Reset the timer interrupt flag
+                    highest_priority->pcb->end_timer_time = clock; // Record the end time of the timer interrupt
+                    highest_priority->pcb->ready_waiting_time += highest_priority->pcb->end_timer_time - highest_priority->pcb->start_timer_time; // Update the total waiting time in the ready state due to timer interrupt
+                }
+
+                removed = (mlfq || dense_tick) ? highest_priority : dequeueNode(ready_queue, highest_priority);
+                enqueue(running_queue, removed);
+                trace_transition(logging, trace, &transitions, clock, removed->pcb->pid, STATE_READY, STATE_RUNNING);
+            }
+        }
+
+        // Samples the queue depths and the CPU utilisation at the end of the tick, and the last partial interval before the simulation ends or pauses
+        if (telemetry != NULL) {
+            bool last = (terminated_queue->size == size || (checkpoint->filename != NULL && clock + 1 == checkpoint->stop_time));
+            sample_telemetry(telemetry, clock, sim, last);
+        }
+
+        // Increments the timer after each loop
+        clock++; 
+    }
+    
+    if (dense_tick) {
+        free_dense_queue(dense_waiting);
+    }
+    if (dense_ready != NULL) {
+        free_dense_queue(dense_ready);
+    }
+
+    // The kernel overhead of the transitions after the last dispatch is charged even though no PCB is dispatched after them
+    switch_time += config->transition_overhead * transitions;
+    transitions = 0;
+
+    sim->clock = clock;
+    sim->switch_time = switch_time;
+    sim->pending_transitions = transitions;
+    return terminated_queue;
+}
+
+/**
+ * This function runs the simulation and logs every state transition.
+ *
+ * @return a pointer to the terminated queue, or NULL if the simulation was paused.
+ */
+queue_t *flow_process_logged(simulation_t *sim, trace_t *trace, const config_t *config, telemetry_t *telemetry){
+    return simulate(sim, trace, config, telemetry, true);
+}
+
+/**
+ * This function runs the simulation without logging any state transition, only the fields the metrics are calculated from are kept.
+ *
+ * @return a pointer to the terminated queue, or NULL if the simulation was paused.
+ */
+queue_t *flow_process_metrics_only(simulation_t *sim, trace_t *trace, const config_t *config, telemetry_t *telemetry){
+    return simulate(sim, trace, config, telemetry, false);
+}
+
+/**
+ * This function simulates an OS kernel, processing PCB state transitions.
+ * The log mode is checked once per run to choose the instantiation of the simulation loop: with LOG_NONE the metrics-only
+ * instantiation runs, which contains no logging code at all.
+ * 
+ * @param sim          A pointer to the simulation to run.
+ * @param trace        A pointer to the transition log.
+ * @param config       A pointer to the settings of the run (algorithm, quantum, CPUs, checkpoints and tick mode).
+ * @param telemetry    A pointer to the telemetry sampler, or NULL to run without telemetry.
+ * 
+ * @return a pointer to the terminated queue, or NULL if the simulation was paused.
+ */
+queue_t *flow_process(simulation_t *sim, trace_t *trace, const config_t *config, telemetry_t *telemetry){
+    if (trace->mode == LOG_NONE) {
+        return flow_process_metrics_only(sim, trace, config, telemetry);
+    }
+    return flow_process_logged(sim, trace, config, telemetry);
+}
+
+/**
+ * Calculates the average turnaround time for processes in the queue.
+ *
+ * @param queue     Pointer to the queue containing PCBs.
+ * @return          The average turnaround time of the processes in the queue.
+ */
+float average_turnaround_time(queue_t *queue){
+    float sum = 0;
+    for (node_t *current = queue->front; current != NULL; current = current->next) {
+        sum += (current->pcb->end_time - current->pcb->arrival_time);
+    }
+    float turnaround = sum / (queue->size);
+    return turnaround;
+}
+
+/**
+ * Calculates the average waiting time for processes in the queue.
+ *
+ * @param queue     Pointer to the queue containing PCBs.
  * @return          The average waiting time of the processes in the queue.
  */
 float average_waiting_time(queue_t *queue){
@@ -403,6 +1896,23 @@ float average_waiting_time(queue_t *queue){
     return waiting;
 }
 
+/**
+ * Calculates the CPU efficiency, the share of the CPU time spent running processes rather than switching between them.
+ *
+ * @param queue         Pointer to the queue containing PCBs.
+ * @param switch_time   The CPU time spent on context switches and kernel overhead.
+ * @return              The CPU efficiency of the processes in the queue.
+ */
+float cpu_efficiency(queue_t *queue, int switch_time){
+    double useful = 0;
+    node_t *current = queue->front;
+    for (int i = 0; i < queue->size; i++) {
+        useful += current->pcb->total_CPU_time;
+        current = current->next;
+    }
+    return (useful + switch_time > 0) ? (float)(useful / (useful + switch_time)) : 1;
+}
+
 /**
  * Calculates the throughput of the processes in the queue.
  *
@@ -414,21 +1924,774 @@ float throughput(queue_t *queue){
     return throughput;
 }
 
+/**
+ * This function frees a simulation together with all of its queues, nodes and PCBs.
+ *
+ * @param sim   A pointer to the simulation to free.
+ */
+void free_simulation(simulation_t *sim) {
+    queue_t *queues[5 + MLFQ_LEVELS] = {sim->new_queue, sim->ready_queue, sim->running_queue, sim->waiting_queue, sim->terminated_queue};
+    for (int level = 0; level < MLFQ_LEVELS; level++) {
+        queues[5 + level] = sim->levels[level];
+    }
+    for (int i = 0; i < 5 + MLFQ_LEVELS; i++) {
+        node_t *current = queues[i]->front;
+        for (int j = 0; j < queues[i]->size; j++) {
+            node_t *next = current->next;
+            free(current->pcb);
+            free(current);
+            current = next;
+        }
+        free(queues[i]);
+    }
+    for (int i = 0; i < sim->device_count; i++) {
+        node_t *current = sim->devices[i].queue->front;
+        for (int j = 0; j < sim->devices[i].queue->size; j++) {
+            node_t *next = current->next;
+            free(current->pcb);
+            free(current);
+            current = next;
+        }
+        free(sim->devices[i].queue);
+    }
+    free(sim);
+}
+
+/**
+ * This function returns the next number of a SplitMix64 random stream.
+ *
+ * @param state   A pointer to the state of the stream.
+ * @return        The next 64-bit random number.
+ */
+uint64_t next_random(uint64_t *state) {
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+/**
+ * This function changes a value by a random relative amount in [-spread, spread] and rounds the result.
+ *
+ * @param state    A pointer to the state of the random stream.
+ * @param value    The value to change.
+ * @param spread   The maximum relative change.
+ * @param minimum  The lowest value the result may have.
+ * @return         The changed value.
+ */
+int perturb(uint64_t *state, int value, double spread, int minimum) {
+    double u = (double)(next_random(state) >> 11) / 9007199254740992.0; // Uniform in [0, 1)
+    int result = (int)lround(value * (1.0 + spread * (2.0 * u - 1.0)));
+    return (result < minimum) ? minimum : result;
+}
+
+/**
+ * This function compares two PCBs by arrival time and then by process ID, used to sort a replica into arrival order.
+ */
+int compare_arrival(const void *a, const void *b) {
+    const pcb_t *pa = a;
+    const pcb_t *pb = b;
+    if (pa->arrival_time != pb->arrival_time) {
+        return (pa->arrival_time < pb->arrival_time) ? -1 : 1;
+    }
+    return (pa->pid > pb->pid) - (pa->pid < pb->pid);
+}
+
+/**
+ * This function builds the new queue of one randomized replica of the workload.
+ * The random stream of a replica depends only on the seed and the replica number, so the results do not depend on the number of threads.
+ *
+ * @param ensemble   A pointer to the ensemble.
+ * @param replica    The number of the replica.
+ * @return           A pointer to the new queue of the replica, in arrival order.
+ */
+queue_t *build_replica(const ensemble_t *ensemble, int replica) {
+    uint64_t state = ensemble->seed ^ ((uint64_t)(replica + 1) * 0xD1B54A32D192ED03ULL);
+    pcb_t *pcbs = malloc(ensemble->pcb_count * sizeof(pcb_t));
+    assert(pcbs != NULL);
+
+    for (int i = 0; i < ensemble->pcb_count; i++) {
+        const pcb_t *base = &ensemble->workload[i];
+        pcbs[i] = *base;
+        pcbs[i].arrival_time = perturb(&state, base->arrival_time, ensemble->spread, 0);
+        pcbs[i].total_CPU_time = perturb(&state, base->total_CPU_time, ensemble->spread, 1);
+        // A PCB without I/O keeps an I/O duration of 0, every other I/O lasts at least 1 ms
+        pcbs[i].io_duration = (base->io_duration == 0) ? 0 : perturb(&state, base->io_duration, ensemble->spread, 1);
+    }
+
+    // flow_process moves PCBs from the front of the new queue, so the replica has to be in arrival order
+    qsort(pcbs, ensemble->pcb_count, sizeof(pcb_t), compare_arrival);
+
+    queue_t *queue = alloc_queue();
+    for (int i = 0; i < ensemble->pcb_count; i++) {
+        node_t *p = malloc(sizeof(node_t));
+        assert(p != NULL);
+        p->pcb = new_pcb(pcbs[i].pid, pcbs[i].arrival_time, pcbs[i].total_CPU_time, pcbs[i].io_frequency, pcbs[i].io_duration, pcbs[i].priority);
+        p->pcb->device = pcbs[i].device;
+        p->pcb->track = pcbs[i].track;
+        p->next = NULL;
+        enqueue(queue, p);
+    }
+    free(pcbs);
+    return queue;
+}
+
+/**
+ * This function runs the replicas assigned to one ensemble thread, simulating each of them with every algorithm.
+ *
+ * @param arg   A pointer to the ensemble_worker_t of the thread.
+ * @return      NULL.
+ */
+void *run_ensemble_worker(void *arg) {
+    ensemble_worker_t *worker = arg;
+    ensemble_t *ensemble = worker->ensemble;
+    trace_t trace;
+    open_trace(&trace, NULL, LOG_NONE, 0);
+
+    // Every replica runs with the settings of the ensemble apart from the algorithm, and never saves checkpoints
+    config_t config = *ensemble->config;
+    config.checkpoint.filename = NULL;
+
+    for (int replica = worker->index; replica < ensemble->replicas; replica += ensemble->thread_count) {
+        for (int a = 0; a < ENSEMBLE_ALGORITHMS; a++) {
+            config.algorithm = (algorithm_t)a;
+            simulation_t *sim = new_simulation(build_replica(ensemble, replica), config.devices);
+            queue_t *terminated_queue = flow_process(sim, &trace, &config, NULL);
+
+            float *metrics = &ensemble->results[(replica * ENSEMBLE_ALGORITHMS + a) * ENSEMBLE_METRICS];
+            metrics[0] = throughput(terminated_queue);
+            metrics[1] = average_turnaround_time(terminated_queue);
+            metrics[2] = average_waiting_time(terminated_queue);
+
+            free_simulation(sim);
+        }
+    }
+    return NULL;
+}
+
+/**
+ * This function returns the two-sided 95% critical value of Student's t distribution.
+ *
+ * @param df   The degrees of freedom.
+ * @return     The critical value.
+ */
+double t_critical_95(int df) {
+    static const double table[30] = {12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+                                     2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+                                     2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042};
+    if (df < 1) {
+        return 0;
+    }
+    return (df <= 30) ? table[df - 1] : 1.960;
+}
+
+/**
+ * This function simulates randomized replicas of a workload in parallel and writes the mean and the 95% confidence interval
+ * of each metric for each algorithm.
+ *
+ * @param ensemble   A pointer to the ensemble settings.
+ * @param filename   The name of the output file for the ensemble metrics.
+ * @return           true if the ensemble ran and its metrics were written, false otherwise.
+ */
+bool run_ensemble(ensemble_t *ensemble, const char *filename) {
+    ensemble->results = malloc((size_t)ensemble->replicas * ENSEMBLE_ALGORITHMS * ENSEMBLE_METRICS * sizeof(float));
+    pthread_t *threads = malloc(ensemble->thread_count * sizeof(pthread_t));
+    ensemble_worker_t *workers = malloc(ensemble->thread_count * sizeof(ensemble_worker_t));
+    bool *started = malloc(ensemble->thread_count * sizeof(bool));
+    assert(ensemble->results != NULL && threads != NULL && workers != NULL && started != NULL);
+
+    for (int t = 0; t < ensemble->thread_count; t++) {
+        workers[t].ensemble = ensemble;
+        workers[t].index = t;
+        started[t] = (pthread_create(&threads[t], NULL, run_ensemble_worker, &workers[t]) == 0);
+    }
+
+    // The replicas of a worker whose thread could not be created are simulated on this thread instead, every replica has its own
+    // random stream, so the results are the same
+    int failed = 0;
+    for (int t = 0; t < ensemble->thread_count; t++) {
+        if (!started[t]) {
+            run_ensemble_worker(&workers[t]);
+            failed++;
+        }
+    }
+    for (int t = 0; t < ensemble->thread_count; t++) {
+        if (started[t]) {
+            pthread_join(threads[t], NULL);
+        }
+    }
+    if (failed > 0) {
+        printf("Warning: %d of %d threads could not be created, their replicas were simulated on the main thread\n", failed, ensemble->thread_count);
+    }
+    free(started);
+    free(threads);
+    free(workers);
+
+    FILE *file = fopen(filename, "w");
+    if (file == NULL) {
+        printf("Error opening file %s\n", filename);
+        free(ensemble->results);
+        return false;
+    }
+
+    fprintf(file, "%-15s %-10s %-30s %-30s %-30s\n", "Algorithm", "Replicas", "Throughput", "Average Turnaround Time", "Average Waiting Time");
+
+    // The replicas are aggregated in replica order, so the sums are the same for any number of threads
+    for (int a = 0; a < ENSEMBLE_ALGORITHMS; a++) {
+        char columns[ENSEMBLE_METRICS][64];
+        for (int m = 0; m < ENSEMBLE_METRICS; m++) {
+            double sum = 0, squares = 0;
+            for (int r = 0; r < ensemble->replicas; r++) {
+                double x = ensemble->results[(r * ENSEMBLE_ALGORITHMS + a) * ENSEMBLE_METRICS + m];
+                sum += x;
+                squares += x * x;
+            }
+            int n = ensemble->replicas;
+            double mean = sum / n;
+            double variance = (n > 1) ? (squares - n * mean * mean) / (n - 1) : 0;
+            double half_width = t_critical_95(n - 1) * sqrt(variance > 0 ? variance : 0) / sqrt(n);
+            snprintf(columns[m], sizeof(columns[m]), "%f +/- %f", mean, half_width);
+        }
+        fprintf(file, "%-15s %-10d %-30s %-30s %-30s\n", algorithm_names[a], ensemble->replicas, columns[0], columns[1], columns[2]);
+    }
+
+    fclose(file);
+    free(ensemble->results);
+    return true;
+}
+
+/**
+ * This function checks that every PCB uses one of the I/O devices.
+ *
+ * @param queue          A pointer to the queue containing PCBs.
+ * @param device_count   The number of I/O devices, or 0 if every waiting PCB does its I/O in parallel.
+ * @return               true if the device of every PCB exists, false otherwise.
+ */
+bool check_devices(const queue_t *queue, int device_count) {
+    if (device_count == 0) {
+        return true;
+    }
+    node_t *current = queue->front;
+    for (int i = 0; i < queue->size; i++) {
+        if (current->pcb->device < 0 || current->pcb->device >= device_count) {
+            printf("Error: PCB %d uses I/O device %d, but there are only %d devices\n", current->pcb->pid, current->pcb->device, device_count);
+            return false;
+        }
+        current = current->next;
+    }
+    return true;
+}
+
+/**
+ * This function prints the command line options of the simulator.
+ *
+ * @param program   The name the program was started with.
+ */
+void print_usage(const char *program) {
+    printf("Usage: %s [options] [INPUT OUTPUT METRICS ALGORITHM]\n", program);
+    printf("       %s render TRACE OUTPUT\n\n", program);
+    printf("Options (every option can also be set as 'name = value' in the config file):\n");
+    printf("  --config FILE                Read options from FILE, options on the command line take precedence\n");
+    printf("  --input FILE                 The CSV file with the PCBs\n");
+    printf("  --output FILE                The file the state transitions are logged to\n");
+    printf("  --metrics FILE               The file the metrics are written to\n");
+    printf("  --algorithm NAME             FCFS, RoundRobin, Priority or MLFQ\n");
+    printf("  --quantum MS                 The time quantum of RoundRobin (1) or of the highest MLFQ level (%d)\n", MLFQ_BASE_QUANTUM);
+    printf("  --cpus N                     The number of CPUs (1)\n");
+    printf("  --switch-cost MS             The CPU time of a context switch to a dispatched PCB (0)\n");
+    printf("  --transition-overhead MS     The CPU time the kernel spends on every state transition (0)\n");
+    printf("  --devices N                  The number of I/O devices, each with its own queue (0, unlimited parallel I/O)\n");
+    printf("  --io-scheduling ORDER        fifo or elevator, the order in which a device serves its requests (fifo)\n");
+    printf("  --seek-time MS               The time the head of a device takes to move by one track (0)\n");
+    printf("  --log MODE                   text, binary or none (text)\n");
+    printf("  --trace-buffer N             The number of records buffered by the binary trace (%d)\n", TRACE_BUFFER_RECORDS);
+    printf("  --checkpoint FILE            Save checkpoints to FILE\n");
+    printf("  --checkpoint-interval MS     Save a checkpoint every MS ms (0, only when stopping)\n");
+    printf("  --stop TIME                  Save a checkpoint and pause the simulation at TIME\n");
+    printf("  --resume FILE                Continue the simulation saved in FILE instead of reading an input file\n");
+    printf("  --telemetry FILE             Sample the queue sizes and the CPU utilisation to FILE\n");
+    printf("  --telemetry-interval MS      Sample every MS ms (0, whenever a gauge changes)\n");
+    printf("  --telemetry-buffer BYTES     The size of the buffer of the telemetry file\n");
+    printf("  --dense                      Run the dense tick mode with the vectorized kernels\n");
+    printf("  --ensemble N                 Simulate N randomized replicas with every algorithm\n");
+    printf("  --seed N                     The seed of the ensemble random streams (0)\n");
+    printf("  --spread PERCENT             The maximum change of the ensemble workloads (10)\n");
+    printf("  --threads N                  The number of threads running ensemble replicas (1)\n");
+    printf("  --help                       Print this message\n");
+}
+
+/**
+ * This function parses a whole string as a decimal integer within a range.
+ *
+ * @param text      The string to parse.
+ * @param minimum   The smallest accepted value.
+ * @param maximum   The largest accepted value.
+ * @param value     A pointer to the parsed value.
+ * @return          true if the string is an integer within the range, false otherwise.
+ */
+bool parse_int(const char *text, long minimum, long maximum, int *value) {
+    char *end;
+    errno = 0;
+    long parsed = strtol(text, &end, 10);
+    if (end == text || *end != '\0' || errno != 0 || parsed < minimum || parsed > maximum) {
+        return false;
+    }
+    *value = (int)parsed;
+    return true;
+}
+
+/**
+ * This function sets one option of the configuration from its name and value.
+ *
+ * @param config   A pointer to the configuration.
+ * @param name     The long name of the option, without the leading dashes.
+ * @param value    The value of the option (NULL for a flag given without a value).
+ * @return         true if the option is known and its value is valid, false otherwise.
+ */
+bool set_option(config_t *config, const char *name, const char *value) {
+    // The only flag is --dense, every other option needs a value
+    if (strcmp(name, "dense") == 0) {
+        if (value == NULL || strcmp(value, "true") == 0 || strcmp(value, "1") == 0) {
+            config->dense_tick = true;
+        }
+        else if (strcmp(value, "false") == 0 || strcmp(value, "0") == 0) {
+            config->dense_tick = false;
+        }
+        else {
+            printf("Error: --dense expects true or false, not '%s'\n", value);
+            return false;
+        }
+        return true;
+    }
+    if (value == NULL) {
+        printf("Error: option --%s needs a value\n", name);
+        return false;
+    }
+
+    bool valid = true;
+    if (strcmp(name, "input") == 0) {
+        config->input = value;
+    }
+    else if (strcmp(name, "output") == 0) {
+        config->output = value;
+    }
+    else if (strcmp(name, "metrics") == 0) {
+        config->metrics = value;
+    }
+    else if (strcmp(name, "algorithm") == 0) {
+        valid = false;
+        for (int a = 0; a < ENSEMBLE_ALGORITHMS; a++) {
+            if (strcmp(value, algorithm_names[a]) == 0) {
+                config->algorithm = (algorithm_t)a;
+                valid = true;
+            }
+        }
+        config->algorithm_set = true;
+    }
+    else if (strcmp(name, "quantum") == 0) {
+        // The lowest MLFQ level has a quantum of quantum << (MLFQ_LEVELS - 1), which has to fit in an int
+        valid = parse_int(value, 1, INT_MAX >> MLFQ_LEVELS, &config->quantum);
+    }
+    else if (strcmp(name, "cpus") == 0) {
+        valid = parse_int(value, 1, 4096, &config->cpus);
+    }
+    else if (strcmp(name, "switch-cost") == 0) {
+        valid = parse_int(value, 0, 1 << 20, &config->switch_cost);
+    }
+    else if (strcmp(name, "transition-overhead") == 0) {
+        valid = parse_int(value, 0, 1 << 10, &config->transition_overhead);
+    }
+    else if (strcmp(name, "devices") == 0) {
+        valid = parse_int(value, 0, MAX_DEVICES, &config->devices);
+    }
+    else if (strcmp(name, "io-scheduling") == 0) {
+        if (strcmp(value, "fifo") == 0) {
+            config->io_policy = IO_FIFO;
+        }
+        else if (strcmp(value, "elevator") == 0) {
+            config->io_policy = IO_ELEVATOR;
+        }
+        else {
+            valid = false;
+        }
+        config->io_policy_set = true;
+    }
+    else if (strcmp(name, "seek-time") == 0) {
+        valid = parse_int(value, 0, 1 << 20, &config->seek_time);
+    }
+    else if (strcmp(name, "log") == 0) {
+        if (strcmp(value, "text") == 0) {
+            config->log_mode = LOG_TEXT;
+        }
+        else if (strcmp(value, "binary") == 0) {
+            config->log_mode = LOG_BINARY;
+        }
+        else if (strcmp(value, "none") == 0) {
+            config->log_mode = LOG_NONE;
+        }
+        else {
+            valid = false;
+        }
+        config->log_mode_set = true;
+    }
+    else if (strcmp(name, "trace-buffer") == 0) {
+        valid = parse_int(value, 1, 1 << 24, &config->trace_buffer);
+    }
+    else if (strcmp(name, "telemetry-buffer") == 0) {
+        valid = parse_int(value, 1, 1 << 30, &config->file_buffer);
+    }
+    else if (strcmp(name, "checkpoint") == 0) {
+        config->checkpoint.filename = value;
+    }
+    else if (strcmp(name, "checkpoint-interval") == 0) {
+        valid = parse_int(value, 0, INT_MAX, &config->checkpoint.interval);
+    }
+    else if (strcmp(name, "stop") == 0) {
+        valid = parse_int(value, 0, INT_MAX, &config->checkpoint.stop_time);
+    }
+    else if (strcmp(name, "resume") == 0) {
+        config->resume = value;
+    }
+    else if (strcmp(name, "telemetry") == 0) {
+        config->telemetry = value;
+    }
+    else if (strcmp(name, "telemetry-interval") == 0) {
+        valid = parse_int(value, 0, INT_MAX, &config->telemetry_interval);
+        config->telemetry_interval_set = true;
+    }
+    else if (strcmp(name, "ensemble") == 0) {
+        valid = parse_int(value, 1, 10000000, &config->replicas);
+    }
+    else if (strcmp(name, "seed") == 0) {
+        char *end;
+        errno = 0;
+        config->seed = strtoull(value, &end, 10);
+        valid = (end != value && *end == '\0' && errno == 0 && value[0] != '-');
+        config->ensemble_option_set = true;
+    }
+    else if (strcmp(name, "spread") == 0) {
+        char *end;
+        double percent = strtod(value, &end);
+        valid = (end != value && *end == '\0' && percent >= 0 && percent <= 100);
+        config->spread = percent / 100.0;
+        config->ensemble_option_set = true;
+    }
+    else if (strcmp(name, "threads") == 0) {
+        valid = parse_int(value, 1, 1024, &config->threads);
+        config->ensemble_option_set = true;
+    }
+    else {
+        printf("Error: unknown option --%s\n", name);
+        return false;
+    }
+
+    if (!valid) {
+        printf("Error: invalid value '%s' for --%s\n", value, name);
+    }
+    return valid;
+}
+
+/**
+ * This function reads options from a config file. Every line holds one 'name = value' pair with the long name of an option,
+ * and everything after a '#' is a comment.
+ *
+ * @param config     A pointer to the configuration.
+ * @param filename   The name of the config file.
+ * @return           true if the file was read and all of its options are valid, false otherwise.
+ */
+bool load_config_file(config_t *config, const char *filename) {
+    FILE *file = fopen(filename, "r");
+    if (file == NULL) {
+        printf("Error opening file %s\n", filename);
+        return false;
+    }
+
+    char line[1024];
+    int line_number = 0;
+    bool valid = true;
+    while (valid && fgets(line, sizeof(line), file) != NULL) {
+        line_number++;
+        char *comment = strchr(line, '#');
+        if (comment != NULL) {
+            *comment = '\0';
+        }
+
+        // Split the line at the '=' and trim the white space around the name and the value
+        char *name = line;
+        while (*name == ' ' || *name == '\t') {
+            name++;
+        }
+        if (*name == '\0' || *name == '\n' || *name == '\r') {
+            continue;
+        }
+        char *value = strchr(name, '=');
+        if (value == NULL) {
+            printf("Error in %s line %d: expected 'name = value'\n", filename, line_number);
+            valid = false;
+            break;
+        }
+        char *end = value;
+        *value++ = '\0';
+        while (end > name && (end[-1] == ' ' || end[-1] == '\t')) {
+            *--end = '\0';
+        }
+        while (*value == ' ' || *value == '\t') {
+            value++;
+        }
+        end = value + strlen(value);
+        while (end > value && (end[-1] == ' ' || end[-1] == '\t' || end[-1] == '\n' || end[-1] == '\r')) {
+            *--end = '\0';
+        }
+
+        // The configuration keeps pointers to the path values, so every value gets its own copy
+        size_t length = strlen(value) + 1;
+        char *copy = malloc(length);
+        assert(copy != NULL);
+        memcpy(copy, value, length);
+        if (!set_option(config, name, copy)) {
+            printf("Error in %s line %d\n", filename, line_number);
+            valid = false;
+        }
+    }
+
+    fclose(file);
+    return valid;
+}
+
+/**
+ * This function rejects missing settings and combinations of options that cannot be used together, before anything is simulated.
+ *
+ * @param config   A pointer to the configuration.
+ * @return         true if the configuration can be run, false otherwise.
+ */
+bool validate_config(const config_t *config) {
+    bool ensemble = (config->replicas > 0);
+    const char *error = NULL;
+
+    if (config->input == NULL && config->resume == NULL) {
+        error = "an input file (--input) or a checkpoint to resume (--resume) is required";
+    }
+    else if (config->input != NULL && config->resume != NULL) {
+        error = "--input and --resume cannot be used together, a resumed simulation takes its PCBs from the checkpoint";
+    }
+    else if (config->metrics == NULL) {
+        error = "a metrics file (--metrics) is required";
+    }
+    else if (!ensemble && !config->algorithm_set) {
+        error = "an algorithm (--algorithm) is required";
+    }
+    else if (!ensemble && config->output == NULL && config->log_mode != LOG_NONE) {
+        error = "an output file (--output) is required unless --log none is given";
+    }
+    else if (config->output != NULL && config->log_mode == LOG_NONE) {
+        error = "--output cannot be used with --log none";
+    }
+    else if (!ensemble && config->quantum > 0 && config->algorithm != ALG_ROUND_ROBIN && config->algorithm != ALG_MLFQ) {
+        error = "--quantum can only be used with RoundRobin or MLFQ";
+    }
+    else if (config->devices == 0 && (config->io_policy_set || config->seek_time > 0)) {
+        error = "--io-scheduling and --seek-time need I/O devices (--devices)";
+    }
+    else if (config->devices > 0 && config->dense_tick) {
+        error = "--dense cannot be used with --devices, the dense tick mode only models unlimited parallel I/O";
+    }
+    else if (config->trace_buffer != TRACE_BUFFER_RECORDS && config->log_mode != LOG_BINARY) {
+        error = "--trace-buffer can only be used with --log binary";
+    }
+    else if (config->checkpoint.filename == NULL && (config->checkpoint.interval > 0 || config->checkpoint.stop_time >= 0)) {
+        error = "--checkpoint-interval and --stop need a checkpoint file (--checkpoint)";
+    }
+    else if (config->telemetry == NULL && (config->telemetry_interval_set || config->file_buffer > 0)) {
+        error = "--telemetry-interval and --telemetry-buffer need a telemetry file (--telemetry)";
+    }
+    else if (!ensemble && config->ensemble_option_set) {
+        error = "--seed, --spread and --threads can only be used with --ensemble";
+    }
+    else if (ensemble && config->algorithm_set) {
+        error = "--algorithm cannot be used with --ensemble, every replica is simulated with every algorithm";
+    }
+    else if (ensemble && (config->checkpoint.filename != NULL || config->resume != NULL || config->telemetry != NULL)) {
+        error = "--checkpoint, --resume and --telemetry cannot be used with --ensemble";
+    }
+    else if (ensemble && (config->log_mode_set || config->output != NULL)) {
+        error = "--output and --log cannot be used with --ensemble, no transitions are logged";
+    }
+
+    if (error != NULL) {
+        printf("Error: %s\n", error);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * This function reads the configuration from the command line and the optional config file.
+ * Options are given as '--name value' or '--name=value', and the legacy positional form INPUT OUTPUT METRICS ALGORITHM is still accepted.
+ *
+ * @param config   A pointer to the configuration to fill.
+ * @param argc     The number of command line arguments.
+ * @param argv     The command line arguments.
+ * @return         true if the configuration is complete and valid, false otherwise.
+ */
+bool parse_arguments(config_t *config, int argc, char *argv[]) {
+    const config_t defaults = {
+        .cpus = 1,
+        .log_mode = LOG_TEXT,
+        .trace_buffer = TRACE_BUFFER_RECORDS,
+        .checkpoint = {NULL, 0, -1},
+        .spread = 0.10,
+        .threads = 1,
+    };
+    *config = defaults;
+
+    // The config file is read first, so every option given on the command line overrides it
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--config") == 0 || strncmp(argv[i], "--config=", 9) == 0) {
+            const char *filename = (argv[i][8] == '=') ? &argv[i][9] : (i + 1 < argc ? argv[i + 1] : NULL);
+            if (filename == NULL) {
+                printf("Error: option --config needs a value\n");
+                return false;
+            }
+            if (!load_config_file(config, filename)) {
+                return false;
+            }
+        }
+    }
+
+    const char *positional_names[] = {"input", "output", "metrics", "algorithm"};
+    int positional = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--", 2) != 0) {
+            if (positional == 4) {
+                printf("Error: unexpected argument '%s'\n", argv[i]);
+                return false;
+            }
+            if (!set_option(config, positional_names[positional++], argv[i])) {
+                return false;
+            }
+            continue;
+        }
+
+        char name[64];
+        const char *value = NULL;
+        const char *equals = strchr(argv[i], '=');
+        size_t length = (equals != NULL) ? (size_t)(equals - argv[i]) - 2 : strlen(argv[i]) - 2;
+        if (length >= sizeof(name)) {
+            printf("Error: unknown option %s\n", argv[i]);
+            return false;
+        }
+        memcpy(name, argv[i] + 2, length);
+        name[length] = '\0';
+
+        if (equals != NULL) {
+            value = equals + 1;
+        }
+        else if (strcmp(name, "dense") != 0 && i + 1 < argc) {
+            value = argv[++i];
+        }
+
+        if (strcmp(name, "config") == 0) {
+            continue; // Already read
+        }
+        if (!set_option(config, name, value)) {
+            return false;
+        }
+    }
+
+    return validate_config(config);
+}
+
 int main(int argc, char *argv[]){
 
     queue_t *new_queue;
     queue_t *terminated_queue;
+    trace_t trace;
+    config_t config;
     float turnaround_time;
     float waiting_time;
     float throughput_fraction;
 
-    new_queue = read_CSV_file(argv[1]);
+    // Convert a binary trace produced by an earlier run into the text output layout
+    if (argc == 4 && strcmp(argv[1], "render") == 0) {
+        return render_trace(argv[2], argv[3]) ? 0 : 1;
+    }
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--help") == 0) {
+            print_usage(argv[0]);
+            return 0;
+        }
+    }
+    if (argc < 2) {
+        print_usage(argv[0]);
+        return 1;
+    }
+    if (!parse_arguments(&config, argc, argv)) {
+        printf("Run %s --help for the list of options\n", argv[0]);
+        return 1;
+    }
+
+    // An ensemble writes the mean and confidence interval of every metric for every algorithm to the metrics file
+    if (config.replicas > 0) {
+        new_queue = read_CSV_file(config.input);
+        if (new_queue == NULL || !check_devices(new_queue, config.devices)) {
+            return 1;
+        }
+        pcb_t *workload = malloc(new_queue->size * sizeof(pcb_t));
+        assert(workload != NULL);
+        node_t *current = new_queue->front;
+        for (int i = 0; i < new_queue->size; i++) {
+            workload[i] = *current->pcb;
+            current = current->next;
+        }
+        ensemble_t ensemble = {workload, new_queue->size, config.replicas, config.seed, config.spread, &config, config.threads, NULL};
+        bool done = run_ensemble(&ensemble, config.metrics);
+        free(workload);
+        return done ? 0 : 1;
+    }
+
+    // A resumed simulation takes all of its PCBs from the checkpoint instead of the input file
+    simulation_t *sim;
+    if (config.resume != NULL) {
+        sim = load_checkpoint(config.resume);
+        if (sim != NULL && sim->device_count != config.devices) {
+            printf("Error: %s was saved with %d I/O devices, not %d\n", config.resume, sim->device_count, config.devices);
+            return 1;
+        }
+    }
+    else {
+        new_queue = read_CSV_file(config.input);
+        if (new_queue == NULL || !check_devices(new_queue, config.devices)) {
+            return 1;
+        }
+        sim = new_simulation(new_queue, config.devices);
+    }
+    if (sim == NULL) {
+        return 1;
+    }
+    new_queue = sim->new_queue;
+
+    if (!open_trace(&trace, config.output, config.log_mode, config.trace_buffer)) {
+        return 1;
+    }
+
+    telemetry_t telemetry;
+    if (config.telemetry != NULL && !open_telemetry(&telemetry, config.telemetry, config.telemetry_interval, config.cpus, config.file_buffer)) {
+        return 1;
+    }
+
+    terminated_queue = flow_process(sim, &trace, &config, config.telemetry != NULL ? &telemetry : NULL);
 
-    FILE *file1 = fopen(argv[2], "w");
-    fprintf(file1, "%-5s %-4s %-10s %-10s\n", "Time", "PID", "Old State", "New State");
-    fclose(file1);
+    close_trace(&trace);
+    if (config.telemetry != NULL) {
+        close_telemetry(&telemetry);
+    }
 
-    terminated_queue = flow_process(new_queue, argv[2], argv[4]);
+    // A paused simulation has no metrics yet, they are calculated by the run that resumes it
+    if (terminated_queue == NULL) {
+        printf("Simulation paused at time %d, checkpoint saved to %s\n", sim->clock, config.checkpoint.filename);
+        return 0;
+    }
 
     // Calculate the average turnaround time for all of the PCBs
     turnaround_time = average_turnaround_time(terminated_queue);
@@ -439,15 +2702,31 @@ int main(int argc, char *argv[]){
     // Calculate the throughput fraction for all of the PCBs
     throughput_fraction = throughput(terminated_queue);
 
-    FILE *file2 = fopen(argv[3], "w");
-    fprintf(file2, "%-15s %-25s %-25s\n", "Throughput", "Average Turnaround Time", "Average Waiting Time");
-    fprintf(file2, "%-15f %-25f %-25f\n", throughput_fraction, turnaround_time, waiting_time);
+    FILE *file2 = fopen(config.metrics, "w");
+    if (file2 == NULL) {
+        printf("Error opening file %s\n", config.metrics);
+        return 1;
+    }
+    // The switch metrics are only written when switching has a cost, so the calculations of a run without costs keep their layout
+    if (config.switch_cost > 0 || config.transition_overhead > 0) {
+        fprintf(file2, "%-15s %-25s %-25s %-25s %-25s\n", "Throughput", "Average Turnaround Time", "Average Waiting Time", "Total Switch Time", "CPU Efficiency");
+        fprintf(file2, "%-15f %-25f %-25f %-25d %-25f\n", throughput_fraction, turnaround_time, waiting_time, sim->switch_time, cpu_efficiency(terminated_queue, sim->switch_time));
+    }
+    else {
+        fprintf(file2, "%-15s %-25s %-25s\n", "Throughput", "Average Turnaround Time", "Average Waiting Time");
+        fprintf(file2, "%-15f %-25f %-25f\n", throughput_fraction, turnaround_time, waiting_time);
+    }
+
+    // The utilisation of a device is the share of the simulated time in which it was serving a request
+    if (sim->device_count > 0) {
+        fprintf(file2, "\n%-15s %-25s %-25s\n", "Device", "Requests", "Utilisation");
+        for (int i = 0; i < sim->device_count; i++) {
+            fprintf(file2, "%-15d %-25d %-25f\n", i, sim->devices[i].requests, (sim->clock > 0) ? (float)sim->devices[i].busy_ticks / sim->clock : 0);
+        }
+    }
     fclose(file2);
 
-    free(new_queue);
-    free(terminated_queue);
-    free(file1);
-    free(file2);
+    free_simulation(sim);
 
     return 0;
-}
\ No newline at end of file
+}
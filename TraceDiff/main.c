@@ -0,0 +1,612 @@
+/**
+ * Operating Systems
+ * Design and Implementation of a Scheduler Simulator
+ * Transition Log Diff
+ *
+ * @authors	Saja Fawagreh
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <assert.h>
+
+#define SCHEDULER_TRACE_MAGIC "SCHTRC1"   // The magic string identifying a Scheduler binary trace file
+#define MEMORY_TRACE_MAGIC "MEMTRC1"      // The magic string identifying a Memory Management binary trace file
+#define PARTITIONS 4                      // The number of memory partitions of the Memory Management simulator
+
+// Defines the states a PCB can be in, in the order both simulators use in their binary traces
+typedef enum {
+    STATE_NEW,
+    STATE_READY,
+    STATE_RUNNING,
+    STATE_WAITING,
+    STATE_TERMINATED,
+    STATE_COUNT
+} state_t;
+
+// The names of the states as they appear in the text output
+const char *state_names[] = {"New", "Ready", "Running", "Waiting", "Terminated"};
+
+// Defines the layouts a transition log can have
+typedef enum {
+    FORMAT_SCHEDULER_TEXT,     // The 4-column text output of the Scheduler
+    FORMAT_SCHEDULER_BINARY,   // The binary trace of the Scheduler
+    FORMAT_MEMORY_TEXT,        // The 11-column text output of the Memory Management simulator
+    FORMAT_MEMORY_BINARY       // The binary trace of the Memory Management simulator
+} format_t;
+
+// The descriptions of the layouts
+const char *format_names[] = {"Scheduler text log", "Scheduler binary trace", "Memory Management text log", "Memory Management binary trace"};
+
+// Defines a fixed-size record for one state transition in a binary trace, as written by both simulators
+typedef struct {
+    int32_t time;         // The time at which the PCB switches states
+    int32_t pid;          // The process ID
+    uint8_t old_state;    // The old state of the PCB (a state_t value)
+    uint8_t new_state;    // The new state of the PCB (a state_t value)
+    int16_t partition;    // The partition the PCB enters or is removed from (-1 for the Scheduler)
+    int32_t memory;       // The memory needed by the PCB (0 for the Scheduler)
+} trace_record_t;
+
+// Defines one transition read from either layout, with the fields both layouts of a simulator have in common
+typedef struct {
+    int time;             // The time at which the PCB switches states
+    int pid;              // The process ID
+    state_t old_state;    // The old state of the PCB
+    state_t new_state;    // The new state of the PCB
+    int partition;        // The partition the PCB enters or is removed from (-1 for the Scheduler)
+    int used_memory;      // The total used memory after the transition (0 for the Scheduler)
+    long line;            // The line (text) or record number (binary) of the transition in its log
+} record_t;
+
+// Defines a structure reading the transitions of one log in order, one tick at a time
+typedef struct {
+    const char *filename;       // The name of the log file
+    FILE *file;                 // The open log file
+    format_t format;            // The layout of the log
+    long line;                  // The line or record number of the last transition read
+    int used[PARTITIONS];       // The memory used in every partition, replayed to rebuild the used memory of binary Memory Management traces
+    record_t pending;           // The first transition of the next tick, already read
+    bool has_pending;           // true if pending holds a transition
+    record_t *group;            // The transitions of the current tick
+    int group_size;             // The number of transitions of the current tick
+    int group_capacity;         // The number of transitions the group can hold
+    long records;               // The number of transitions read
+} log_reader_t;
+
+// Defines the latencies of one PCB in one log
+typedef struct {
+    int first_time;       // The time of the first transition of the PCB
+    int end_time;         // The time the PCB terminated, or -1
+    int ready_since;      // The time the PCB last entered the ready state, or -1
+    long ready_time;      // The total time the PCB spent in the ready state
+} latency_t;
+
+// Defines an entry of the table of PCBs that have not terminated in both logs yet
+typedef struct {
+    int pid;              // The process ID
+    bool used;            // true if the entry holds a PCB
+    latency_t logs[2];    // The latencies of the PCB in both logs
+} pid_entry_t;
+
+// Defines the aggregate metrics of one log
+typedef struct {
+    long transitions;         // The number of transitions
+    long terminated;          // The number of PCBs that terminated
+    int last_time;            // The time of the last transition
+    double turnaround_sum;    // The sum of the turnaround times of the terminated PCBs
+    double ready_sum;         // The sum of the ready times of the terminated PCBs
+} totals_t;
+
+// Defines the state of a comparison
+typedef struct {
+    pid_entry_t *table;       // An open-addressing table of the PCBs that have not terminated in both logs, indexed by PID
+    int table_capacity;       // The number of entries of the table (a power of 2)
+    int table_size;           // The number of PCBs in the table
+    totals_t totals[2];       // The aggregate metrics of both logs
+    bool diverged;            // true once the first divergence has been reported
+    long differences;         // The number of transitions that differ or are missing in one of the logs
+    long compared_pids;       // The number of PCBs that terminated in both logs
+    int worst_pid;            // The PCB whose turnaround time changed the most
+    long worst_delta;         // The change of the turnaround time of worst_pid
+    FILE *report;             // The per-PID report, or NULL
+} diff_t;
+
+/**
+ * This function returns the state with the given name.
+ *
+ * @param name   The name of the state as it appears in the text output.
+ * @return       The state, or STATE_COUNT if the name is not a state.
+ */
+state_t parse_state(const char *name) {
+    for (int i = 0; i < STATE_COUNT; i++) {
+        if (strcmp(name, state_names[i]) == 0) {
+            return (state_t)i;
+        }
+    }
+    return STATE_COUNT;
+}
+
+/**
+ * This function opens a log and detects its layout from the magic string of a binary trace or the title line of a text log.
+ *
+ * @param reader     A pointer to the reader to initialize.
+ * @param filename   The name of the log file.
+ * @return           true if the log was opened and its layout is known, false otherwise.
+ */
+bool open_log(log_reader_t *reader, const char *filename) {
+    memset(reader, 0, sizeof(*reader));
+    reader->filename = filename;
+    reader->file = fopen(filename, "rb");
+    if (reader->file == NULL) {
+        printf("Error opening file %s\n", filename);
+        return false;
+    }
+
+    // Both binary headers start with the magic string and the record size, the Memory Management header adds the partition sizes and use
+    char magic[8];
+    int32_t record_size;
+    if (fread(magic, sizeof(magic), 1, reader->file) == 1 && fread(&record_size, sizeof(record_size), 1, reader->file) == 1 &&
+        (memcmp(magic, SCHEDULER_TRACE_MAGIC, sizeof(magic)) == 0 || memcmp(magic, MEMORY_TRACE_MAGIC, sizeof(magic)) == 0)) {
+        if (record_size != sizeof(trace_record_t)) {
+            printf("%s was written by an incompatible build.\n", filename);
+            return false;
+        }
+        if (memcmp(magic, MEMORY_TRACE_MAGIC, sizeof(magic)) == 0) {
+            int32_t partition_sizes[PARTITIONS];
+            int32_t partition_used[PARTITIONS];
+            if (fread(partition_sizes, sizeof(partition_sizes), 1, reader->file) != 1 || fread(partition_used, sizeof(partition_used), 1, reader->file) != 1) {
+                printf("%s is truncated.\n", filename);
+                return false;
+            }
+            // A resumed simulation starts its trace with partitions already in use
+            for (int i = 0; i < PARTITIONS; i++) {
+                reader->used[i] = partition_used[i];
+            }
+            reader->format = FORMAT_MEMORY_BINARY;
+        }
+        else {
+            reader->format = FORMAT_SCHEDULER_BINARY;
+        }
+        return true;
+    }
+
+    // A text log starts with its title line, only the Memory Management layout has partition columns
+    char line[1024];
+    rewind(reader->file);
+    if (fgets(line, sizeof(line), reader->file) == NULL || strncmp(line, "Time", 4) != 0) {
+        printf("%s is not a transition log.\n", filename);
+        return false;
+    }
+    reader->line = 1;
+    reader->format = (strstr(line, "Partition") != NULL) ? FORMAT_MEMORY_TEXT : FORMAT_SCHEDULER_TEXT;
+    return true;
+}
+
+/**
+ * This function reads the next transition of a log in log order.
+ *
+ * @param reader   A pointer to the reader.
+ * @param record   A pointer to the transition read.
+ * @return         true if a transition was read, false at the end of the log.
+ */
+bool read_record(log_reader_t *reader, record_t *record) {
+    if (reader->format == FORMAT_SCHEDULER_BINARY || reader->format == FORMAT_MEMORY_BINARY) {
+        trace_record_t raw;
+        if (fread(&raw, sizeof(raw), 1, reader->file) != 1 || raw.old_state >= STATE_COUNT || raw.new_state >= STATE_COUNT) {
+            return false;
+        }
+        record->time = raw.time;
+        record->pid = raw.pid;
+        record->old_state = (state_t)raw.old_state;
+        record->new_state = (state_t)raw.new_state;
+        record->partition = -1;
+        record->used_memory = 0;
+
+        // The used memory is rebuilt the same way the Memory Management simulator renders its traces
+        if (reader->format == FORMAT_MEMORY_BINARY && raw.partition >= 0 && raw.partition < PARTITIONS) {
+            if (raw.old_state == STATE_NEW) {
+                reader->used[raw.partition] = raw.memory;
+            }
+            else if (raw.new_state == STATE_TERMINATED) {
+                reader->used[raw.partition] = 0;
+            }
+            record->partition = raw.partition;
+            for (int i = 0; i < PARTITIONS; i++) {
+                record->used_memory += reader->used[i];
+            }
+        }
+        record->line = ++reader->line;
+        return true;
+    }
+
+    char line[1024];
+    while (fgets(line, sizeof(line), reader->file) != NULL) {
+        reader->line++;
+
+        // The columns are separated by spaces, the Memory Management layout leaves the unused partition column empty
+        char *tokens[32];
+        int count = 0;
+        for (char *token = strtok(line, " \t\r\n"); token != NULL && count < 32; token = strtok(NULL, " \t\r\n")) {
+            tokens[count++] = token;
+        }
+        if (count == 0) {
+            continue;
+        }
+
+        bool valid = (reader->format == FORMAT_SCHEDULER_TEXT) ? (count == 4) : (count >= 8);
+        if (valid) {
+            record->time = atoi(tokens[0]);
+            record->pid = atoi(tokens[1]);
+            record->old_state = parse_state(tokens[count - 2]);
+            record->new_state = parse_state(tokens[count - 1]);
+            record->partition = (reader->format == FORMAT_MEMORY_TEXT) ? atoi(tokens[2]) : -1;
+            record->used_memory = (reader->format == FORMAT_MEMORY_TEXT) ? atoi(tokens[3]) : 0;
+            valid = (record->old_state != STATE_COUNT && record->new_state != STATE_COUNT);
+        }
+        if (!valid) {
+            printf("%s line %ld is not a transition, the rest of the log is ignored.\n", reader->filename, reader->line);
+            return false;
+        }
+        record->line = reader->line;
+        return true;
+    }
+    return false;
+}
+
+/**
+ * This function compares two transitions of the same PCB on the same tick by PID, keeping their log order.
+ *
+ * @param a   A pointer to the first transition.
+ * @param b   A pointer to the second transition.
+ * @return    A negative, zero or positive value if a is ordered before, with or after b.
+ */
+int compare_records(const void *a, const void *b) {
+    const record_t *ra = a;
+    const record_t *rb = b;
+    if (ra->pid != rb->pid) {
+        return (ra->pid > rb->pid) - (ra->pid < rb->pid);
+    }
+    return (ra->line > rb->line) - (ra->line < rb->line);
+}
+
+/**
+ * This function reads all transitions of the next tick of a log into its group, sorted by PID.
+ * Only one tick is held in memory at a time.
+ *
+ * @param reader   A pointer to the reader.
+ * @return         true if a tick was read, false at the end of the log.
+ */
+bool read_group(log_reader_t *reader) {
+    reader->group_size = 0;
+    if (!reader->has_pending) {
+        reader->has_pending = read_record(reader, &reader->pending);
+    }
+
+    while (reader->has_pending && (reader->group_size == 0 || reader->pending.time == reader->group[0].time)) {
+        if (reader->group_size == reader->group_capacity) {
+            reader->group_capacity = (reader->group_capacity == 0) ? 64 : reader->group_capacity * 2;
+            reader->group = realloc(reader->group, reader->group_capacity * sizeof(record_t));
+            assert(reader->group != NULL);
+        }
+        reader->group[reader->group_size++] = reader->pending;
+        reader->records++;
+        reader->has_pending = read_record(reader, &reader->pending);
+    }
+
+    qsort(reader->group, reader->group_size, sizeof(record_t), compare_records);
+    return reader->group_size != 0;
+}
+
+/**
+ * This function returns the entry of a PCB in the table of PCBs that have not terminated in both logs, adding it if needed.
+ * The table doubles whenever it is half full.
+ *
+ * @param diff   A pointer to the comparison.
+ * @param pid    The process ID.
+ * @return       A pointer to the entry of the PCB.
+ */
+pid_entry_t *find_pid(diff_t *diff, int pid) {
+    if (2 * (diff->table_size + 1) > diff->table_capacity) {
+        pid_entry_t *old = diff->table;
+        int old_capacity = diff->table_capacity;
+        diff->table_capacity = (old_capacity == 0) ? 1024 : old_capacity * 2;
+        diff->table = calloc(diff->table_capacity, sizeof(pid_entry_t));
+        assert(diff->table != NULL);
+        diff->table_size = 0;
+        for (int i = 0; i < old_capacity; i++) {
+            if (old[i].used) {
+                *find_pid(diff, old[i].pid) = old[i];
+            }
+        }
+        free(old);
+    }
+
+    unsigned mask = diff->table_capacity - 1;
+    unsigned index = ((unsigned)pid * 2654435761u) & mask;
+    while (diff->table[index].used && diff->table[index].pid != pid) {
+        index = (index + 1) & mask;
+    }
+
+    pid_entry_t *entry = &diff->table[index];
+    if (!entry->used) {
+        entry->used = true;
+        entry->pid = pid;
+        for (int i = 0; i < 2; i++) {
+            entry->logs[i].first_time = -1;
+            entry->logs[i].end_time = -1;
+            entry->logs[i].ready_since = -1;
+            entry->logs[i].ready_time = 0;
+        }
+        diff->table_size++;
+    }
+    return entry;
+}
+
+/**
+ * This function removes an entry from the table, moving the entries after it back so every PCB stays reachable from its home slot.
+ *
+ * @param diff    A pointer to the comparison.
+ * @param entry   A pointer to the entry to remove.
+ */
+void remove_pid(diff_t *diff, pid_entry_t *entry) {
+    unsigned mask = diff->table_capacity - 1;
+    unsigned hole = (unsigned)(entry - diff->table);
+    unsigned index = hole;
+    diff->table[hole].used = false;
+    diff->table_size--;
+
+    while (true) {
+        index = (index + 1) & mask;
+        if (!diff->table[index].used) {
+            return;
+        }
+        unsigned home = ((unsigned)diff->table[index].pid * 2654435761u) & mask;
+        // The entry can fill the hole if its home slot is not between the hole and its current slot
+        if (((index - home) & mask) >= ((index - hole) & mask)) {
+            diff->table[hole] = diff->table[index];
+            diff->table[index].used = false;
+            hole = index;
+        }
+    }
+}
+
+/**
+ * This function updates the latencies of a PCB with one of its transitions. Once the PCB has terminated in both logs its
+ * latencies are compared, written to the report and dropped, so the table only holds the PCBs that are still active.
+ *
+ * @param diff     A pointer to the comparison.
+ * @param log      The log the transition was read from (0 or 1).
+ * @param record   A pointer to the transition.
+ */
+void update_latency(diff_t *diff, int log, const record_t *record) {
+    pid_entry_t *entry = find_pid(diff, record->pid);
+    latency_t *latency = &entry->logs[log];
+    totals_t *totals = &diff->totals[log];
+
+    totals->transitions++;
+    totals->last_time = record->time;
+    if (latency->first_time == -1) {
+        latency->first_time = record->time;
+    }
+    if (record->old_state == STATE_READY && latency->ready_since != -1) {
+        latency->ready_time += record->time - latency->ready_since;
+        latency->ready_since = -1;
+    }
+    if (record->new_state == STATE_READY) {
+        latency->ready_since = record->time;
+    }
+    if (record->new_state != STATE_TERMINATED) {
+        return;
+    }
+
+    latency->end_time = record->time;
+    totals->terminated++;
+    totals->turnaround_sum += latency->end_time - latency->first_time;
+    totals->ready_sum += latency->ready_time;
+
+    const latency_t *a = &entry->logs[0];
+    const latency_t *b = &entry->logs[1];
+    if (a->end_time == -1 || b->end_time == -1) {
+        return;
+    }
+
+    long turnaround_a = a->end_time - a->first_time;
+    long turnaround_b = b->end_time - b->first_time;
+    long delta = turnaround_b - turnaround_a;
+    diff->compared_pids++;
+    if (labs(delta) > labs(diff->worst_delta)) {
+        diff->worst_delta = delta;
+        diff->worst_pid = entry->pid;
+    }
+    if (diff->report != NULL) {
+        fprintf(diff->report, "%d,%ld,%ld,%ld,%ld,%ld,%ld\n", entry->pid, turnaround_a, turnaround_b, delta, a->ready_time, b->ready_time, b->ready_time - a->ready_time);
+    }
+    remove_pid(diff, entry);
+}
+
+/**
+ * This function prints a transition as it appears in its log, or that it is missing.
+ *
+ * @param label    The name of the log.
+ * @param record   A pointer to the transition, or NULL if the log has no matching transition.
+ */
+void print_record(const char *label, const record_t *record) {
+    if (record == NULL) {
+        printf("  %s: no matching transition\n", label);
+    }
+    else if (record->partition >= 0) {
+        printf("  %s line %ld: time %d, PID %d, %s -> %s, partition %d, used memory %d\n", label, record->line, record->time, record->pid,
+               state_names[record->old_state], state_names[record->new_state], record->partition, record->used_memory);
+    }
+    else {
+        printf("  %s line %ld: time %d, PID %d, %s -> %s\n", label, record->line, record->time, record->pid,
+               state_names[record->old_state], state_names[record->new_state]);
+    }
+}
+
+/**
+ * This function counts a transition that differs between the logs and reports it if it is the first one.
+ *
+ * @param diff   A pointer to the comparison.
+ * @param a      A pointer to the transition of the first log, or NULL if it has none.
+ * @param b      A pointer to the transition of the second log, or NULL if it has none.
+ */
+void report_difference(diff_t *diff, const record_t *a, const record_t *b) {
+    diff->differences++;
+    if (diff->diverged) {
+        return;
+    }
+    diff->diverged = true;
+    const record_t *first = (a != NULL) ? a : b;
+    printf("First divergence at time %d, PID %d:\n", first->time, first->pid);
+    print_record("A", a);
+    print_record("B", b);
+}
+
+/**
+ * This function compares the transitions of one tick. Both groups are sorted by PID, so the transitions of every PCB are
+ * matched in the order the PCB made them, whatever order the PCBs were logged in on that tick.
+ *
+ * @param diff   A pointer to the comparison.
+ * @param a      A pointer to the group of the first log, or NULL if it has no transitions on this tick.
+ * @param b      A pointer to the group of the second log, or NULL if it has no transitions on this tick.
+ */
+void compare_groups(diff_t *diff, const log_reader_t *a, const log_reader_t *b) {
+    int size_a = (a != NULL) ? a->group_size : 0;
+    int size_b = (b != NULL) ? b->group_size : 0;
+    int i = 0, j = 0;
+
+    while (i < size_a || j < size_b) {
+        const record_t *ra = (i < size_a) ? &a->group[i] : NULL;
+        const record_t *rb = (j < size_b) ? &b->group[j] : NULL;
+
+        if (rb == NULL || (ra != NULL && ra->pid < rb->pid)) {
+            report_difference(diff, ra, NULL);
+            update_latency(diff, 0, ra);
+            i++;
+        }
+        else if (ra == NULL || rb->pid < ra->pid) {
+            report_difference(diff, NULL, rb);
+            update_latency(diff, 1, rb);
+            j++;
+        }
+        else {
+            if (ra->old_state != rb->old_state || ra->new_state != rb->new_state ||
+                ra->partition != rb->partition || ra->used_memory != rb->used_memory) {
+                report_difference(diff, ra, rb);
+            }
+            update_latency(diff, 0, ra);
+            update_latency(diff, 1, rb);
+            i++;
+            j++;
+        }
+    }
+}
+
+/**
+ * This function prints one aggregate metric of both logs and its change.
+ *
+ * @param name   The name of the metric.
+ * @param a      The value of the first log.
+ * @param b      The value of the second log.
+ */
+void print_metric(const char *name, double a, double b) {
+    printf("%-25s %-18.3f %-18.3f %-18.3f\n", name, a, b, b - a);
+}
+
+int main(int argc, char *argv[]){
+
+    if (argc < 3 || argc > 4) {
+        printf("Usage: %s LOG_A LOG_B [PID_REPORT.csv]\n", argv[0]);
+        return 2;
+    }
+
+    log_reader_t logs[2];
+    if (!open_log(&logs[0], argv[1]) || !open_log(&logs[1], argv[2])) {
+        return 2;
+    }
+
+    // A Scheduler log can only be compared with another Scheduler log, in either layout, and the same holds for Memory Management logs
+    bool memory_a = (logs[0].format == FORMAT_MEMORY_TEXT || logs[0].format == FORMAT_MEMORY_BINARY);
+    bool memory_b = (logs[1].format == FORMAT_MEMORY_TEXT || logs[1].format == FORMAT_MEMORY_BINARY);
+    if (memory_a != memory_b) {
+        printf("Error: %s is a %s and %s is a %s, they cannot be compared\n", argv[1], format_names[logs[0].format], argv[2], format_names[logs[1].format]);
+        return 2;
+    }
+
+    diff_t diff;
+    memset(&diff, 0, sizeof(diff));
+    if (argc == 4) {
+        diff.report = fopen(argv[3], "w");
+        if (diff.report == NULL) {
+            printf("Error opening file %s\n", argv[3]);
+            return 2;
+        }
+        fprintf(diff.report, "pid,turnaround_a,turnaround_b,turnaround_delta,ready_a,ready_b,ready_delta\n");
+    }
+
+    printf("A: %s (%s)\n", argv[1], format_names[logs[0].format]);
+    printf("B: %s (%s)\n\n", argv[2], format_names[logs[1].format]);
+
+    // Both logs are in time order, so they are merged one tick at a time in a single pass
+    bool more_a = read_group(&logs[0]);
+    bool more_b = read_group(&logs[1]);
+    while (more_a || more_b) {
+        int time_a = more_a ? logs[0].group[0].time : 0;
+        int time_b = more_b ? logs[1].group[0].time : 0;
+        if (more_a && (!more_b || time_a < time_b)) {
+            compare_groups(&diff, &logs[0], NULL);
+            more_a = read_group(&logs[0]);
+        }
+        else if (more_b && (!more_a || time_b < time_a)) {
+            compare_groups(&diff, NULL, &logs[1]);
+            more_b = read_group(&logs[1]);
+        }
+        else {
+            compare_groups(&diff, &logs[0], &logs[1]);
+            more_a = read_group(&logs[0]);
+            more_b = read_group(&logs[1]);
+        }
+    }
+
+    if (!diff.diverged) {
+        printf("The logs are identical (%ld transitions).\n", logs[0].records);
+    }
+    else {
+        printf("\n%ld transitions differ or have no match in the other log (A has %ld, B has %ld).\n", diff.differences, logs[0].records, logs[1].records);
+    }
+
+    const totals_t *a = &diff.totals[0];
+    const totals_t *b = &diff.totals[1];
+    printf("\n%-25s %-18s %-18s %-18s\n", "Metric", "A", "B", "Delta (B - A)");
+    print_metric("Transitions", a->transitions, b->transitions);
+    print_metric("Terminated PCBs", a->terminated, b->terminated);
+    print_metric("Last Transition Time", a->last_time, b->last_time);
+    print_metric("Throughput", a->last_time > 0 ? a->terminated / (double)a->last_time : 0, b->last_time > 0 ? b->terminated / (double)b->last_time : 0);
+    print_metric("Average Turnaround Time", a->terminated > 0 ? a->turnaround_sum / a->terminated : 0, b->terminated > 0 ? b->turnaround_sum / b->terminated : 0);
+    print_metric("Average Ready Time", a->terminated > 0 ? a->ready_sum / a->terminated : 0, b->terminated > 0 ? b->ready_sum / b->terminated : 0);
+
+    printf("\n%ld PCBs terminated in both logs", diff.compared_pids);
+    if (diff.worst_delta != 0) {
+        printf(", the turnaround time of PID %d changed the most (%+ld)", diff.worst_pid, diff.worst_delta);
+    }
+    printf(".\n");
+    if (diff.table_size != 0) {
+        printf("%d PCBs did not terminate in both logs.\n", diff.table_size);
+    }
+
+    if (diff.report != NULL) {
+        fclose(diff.report);
+    }
+    for (int i = 0; i < 2; i++) {
+        fclose(logs[i].file);
+        free(logs[i].group);
+    }
+    free(diff.table);
+
+    return diff.diverged ? 1 : 0;
+}